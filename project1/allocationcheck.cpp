@@ -0,0 +1,168 @@
+#include "constantBlackScholesProcess.hpp"
+#include "mceuropeanengine.hpp"
+#include "bulkgaussianrng.hpp"
+#include <ql/quantlib.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace QuantLib;
+
+// Checks that the sampling loops of the Monte Carlo workers perform no
+// heap allocation once warmed up.
+//
+// usage: allocationcheck [samples]
+//
+// The global operator new is replaced by one counting its calls.  Each
+// worker draws a few samples to warm up and is then asked for the given
+// number of samples; on the generic, constant and batch routes, with
+// PseudoRandom and BulkPseudoRandom:
+// - with IncrementalStatistics, which keeps running sums, no
+//   allocation at all is allowed;
+// - with Statistics, which stores the samples, the only allowed
+//   allocation is the single reserve() made by addSamples().
+// The program exits with a non-zero status if any check fails.
+
+namespace {
+    unsigned long allocations = 0;
+}
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+void operator delete[](void* p) throw() {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) throw() {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) throw() {
+    std::free(p);
+}
+
+template <class W>
+bool check(const std::string& route, const std::string& rng,
+           const std::string& stats, W& worker, Size samples,
+           unsigned long allowed) {
+    worker.addSamples(100);
+    unsigned long before = allocations;
+    worker.addSamples(samples);
+    unsigned long n = allocations - before;
+    bool ok = (n <= allowed);
+    printf("%-9s %-17s %-22s %8lu samples: %3lu allocations  %s\n",
+           route.c_str(), rng.c_str(), stats.c_str(),
+           (unsigned long)samples, n, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+template <class RNG, class S>
+bool checkRoutes(const std::string& rng, const std::string& stats,
+                 unsigned long allowed,
+                 const boost::shared_ptr<GeneralizedBlackScholesProcess>&
+                                                                   process,
+                 const Date& exerciseDate, Real strike, Size samples) {
+    typedef typename AllocationFreeRsg<RNG>::type rsg;
+    typedef PathGenerator_2<rsg> generic_generator;
+    typedef PathGenerator_2<rsg, constantBlackScholesProcess>
+        constant_generator;
+
+    boost::shared_ptr<constantBlackScholesProcess> constantProcess(
+        new constantBlackScholesProcess(process->stateVariable(),
+                                        exerciseDate, strike,
+                                        process->riskFreeRate(),
+                                        process->blackVolatility(),
+                                        process->dividendYield()));
+    Time maturity = process->time(exerciseDate);
+    DiscountFactor discount = process->riskFreeRate()->discount(maturity);
+    boost::shared_ptr<EuropeanPathPricer_2> pricer(
+                     new EuropeanPathPricer_2(Option::Put, strike, discount));
+    TimeGrid grid(maturity, 10), step(maturity, 1);
+    bool ok = true;
+
+    boost::shared_ptr<generic_generator> generic(
+        new generic_generator(process, grid,
+                              AllocationFreeRsg<RNG>::make(10, 42), true));
+    PathMonteCarloWorker_2<generic_generator, S> genericWorker(
+                                                      generic, pricer, true);
+    ok = check("generic", rng, stats, genericWorker, samples, allowed) && ok;
+
+    boost::shared_ptr<constant_generator> constant(
+        new constant_generator(constantProcess, step,
+                               AllocationFreeRsg<RNG>::make(1, 42), false));
+    PathMonteCarloWorker_2<constant_generator, S> constantWorker(
+                                                     constant, pricer, true);
+    ok = check("constant", rng, stats, constantWorker, samples, allowed)
+        && ok;
+
+    BatchMonteCarloWorker_2<rsg, EuropeanPathPricer_2, S> batchWorker(
+                       constantProcess, step, AllocationFreeRsg<RNG>::make(1, 42),
+                       false, pricer, true, 1024);
+    ok = check("batch", rng, stats, batchWorker, samples, allowed) && ok;
+
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+
+    try {
+        Size samples = (argc > 1 ? std::atoi(argv[1]) : 100000);
+        QL_REQUIRE(samples > 0, "at least one sample required");
+
+        Calendar calendar = TARGET();
+        DayCounter dayCounter = Actual365Fixed();
+        Date t0(1, March, 2019);
+        Date T(1, March, 2020);
+        Settings::instance().evaluationDate() = t0;
+        Real strike = 80;
+
+        // same market as main.cpp
+        Handle<YieldTermStructure> rate(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.05, dayCounter)));
+        Handle<Quote> underlying(boost::shared_ptr<Quote>(new SimpleQuote(100)));
+        Handle<BlackVolTermStructure> volatility(boost::shared_ptr<BlackVolTermStructure>(new BlackConstantVol(t0, calendar, 0.15, dayCounter)));
+        Handle<YieldTermStructure> dividend(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.03, dayCounter)));
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_BS(new GeneralizedBlackScholesProcess(underlying, dividend, rate, volatility));
+
+        bool ok = true;
+        ok = checkRoutes<PseudoRandom, IncrementalStatistics>(
+                 "PseudoRandom", "IncrementalStatistics", 0,
+                 process_BS, T, strike, samples) && ok;
+        ok = checkRoutes<BulkPseudoRandom, IncrementalStatistics>(
+                 "BulkPseudoRandom", "IncrementalStatistics", 0,
+                 process_BS, T, strike, samples) && ok;
+        ok = checkRoutes<PseudoRandom, Statistics>(
+                 "PseudoRandom", "Statistics (reserve)", 1,
+                 process_BS, T, strike, samples) && ok;
+        ok = checkRoutes<BulkPseudoRandom, Statistics>(
+                 "BulkPseudoRandom", "Statistics (reserve)", 1,
+                 process_BS, T, strike, samples) && ok;
+
+        if (!ok) {
+            std::cerr << "allocations found in the sampling loop"
+                      << std::endl;
+            return 1;
+        }
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
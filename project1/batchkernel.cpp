@@ -0,0 +1,149 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include "batchkernel.hpp"
+#include <cmath>
+#include <algorithm>
+
+/* The kernels are compiled for AVX2 as well as for the baseline
+   instruction set; the loader picks the version matching the CPU, so
+   that the binaries do not depend on the host they were built on.
+*/
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define BATCH_KERNEL __attribute__((target_clones("avx2","default")))
+#else
+#define BATCH_KERNEL
+#endif
+
+namespace QuantLib {
+
+    BATCH_KERNEL
+    void logNormalStep(const Real* __restrict from, Real* __restrict to,
+                       const Real* __restrict dw, Size n,
+                       Real drift, Real stdDev) {
+        #pragma omp simd
+        for (Size j=0; j<n; j++)
+            to[j] = from[j]*std::exp(drift + stdDev*dw[j]);
+    }
+
+    BATCH_KERNEL
+    void vanillaPayoff(const Real* __restrict spots, Size n, Real omega,
+                       Real strike, Real discount, Real* __restrict prices) {
+        #pragma omp simd
+        for (Size j=0; j<n; j++)
+            prices[j] = discount*std::max(omega*(spots[j]-strike), 0.0);
+    }
+
+    BATCH_KERNEL
+    void importanceWeights(const Real* __restrict spots, Size n,
+                           Real logScale, Real exponent,
+                           Real* __restrict prices) {
+        #pragma omp simd
+        for (Size j=0; j<n; j++)
+            prices[j] *= std::exp(logScale - exponent*std::log(spots[j]));
+    }
+
+    BATCH_KERNEL
+    void philoxUniforms(boost::uint32_t key0, boost::uint32_t key1,
+                        boost::uint64_t counter, Size blocks,
+                        Real* __restrict u) {
+        const Real scale = 1.0/4294967296.0;
+        #pragma omp simd
+        for (Size b=0; b<blocks; b++) {
+            boost::uint64_t c = counter + b;
+            boost::uint32_t x0 = boost::uint32_t(c),
+                            x1 = boost::uint32_t(c >> 32),
+                            x2 = 0, x3 = 0;
+            boost::uint32_t k0 = key0, k1 = key1;
+            for (int r=0; r<10; r++) {
+                boost::uint64_t p0 = boost::uint64_t(0xD2511F53u)*x0;
+                boost::uint64_t p1 = boost::uint64_t(0xCD9E8D57u)*x2;
+                x0 = boost::uint32_t(p1 >> 32) ^ x1 ^ k0;
+                x1 = boost::uint32_t(p1);
+                x2 = boost::uint32_t(p0 >> 32) ^ x3 ^ k1;
+                x3 = boost::uint32_t(p0);
+                k0 += 0x9E3779B9u;
+                k1 += 0xBB67AE85u;
+            }
+            // shifted by half a unit so that 0 and 1 are never returned
+            u[4*b]   = (x0 + 0.5)*scale;
+            u[4*b+1] = (x1 + 0.5)*scale;
+            u[4*b+2] = (x2 + 0.5)*scale;
+            u[4*b+3] = (x3 + 0.5)*scale;
+        }
+    }
+
+    namespace {
+
+        // Acklam's coefficients, as in InverseCumulativeNormal
+        const Real a1_ = -3.969683028665376e+01;
+        const Real a2_ =  2.209460984245205e+02;
+        const Real a3_ = -2.759285104469687e+02;
+        const Real a4_ =  1.383577518672690e+02;
+        const Real a5_ = -3.066479806614716e+01;
+        const Real a6_ =  2.506628277459239e+00;
+
+        const Real b1_ = -5.447609879822406e+01;
+        const Real b2_ =  1.615858368580409e+02;
+        const Real b3_ = -1.556989798598866e+02;
+        const Real b4_ =  6.680131188771972e+01;
+        const Real b5_ = -1.328068155288572e+01;
+
+        const Real c1_ = -7.784894002430293e-03;
+        const Real c2_ = -3.223964580411365e-01;
+        const Real c3_ = -2.400758277161838e+00;
+        const Real c4_ = -2.549732539343734e+00;
+        const Real c5_ =  4.374664141464968e+00;
+        const Real c6_ =  2.938163982698783e+00;
+
+        const Real d1_ =  7.784695709041462e-03;
+        const Real d2_ =  3.224671290700398e-01;
+        const Real d3_ =  2.445134137142996e+00;
+        const Real d4_ =  3.754408661907416e+00;
+
+        const Real x_low_ = 0.02425;
+        const Real x_high_= 1.0 - x_low_;
+
+        inline Real tail(Real x) {
+            // x < x_low_; the upper tail is obtained by symmetry
+            Real z = std::sqrt(-2.0*std::log(x));
+            return (((((c1_*z+c2_)*z+c3_)*z+c4_)*z+c5_)*z+c6_) /
+                ((((d1_*z+d2_)*z+d3_)*z+d4_)*z+1.0);
+        }
+
+    }
+
+    BATCH_KERNEL
+    void inverseCumulativeNormal(const Real* __restrict u, Size n,
+                                 Real* __restrict x) {
+        #pragma omp simd
+        for (Size j=0; j<n; j++) {
+            Real z = u[j] - 0.5;
+            Real r = z*z;
+            x[j] = (((((a1_*r+a2_)*r+a3_)*r+a4_)*r+a5_)*r+a6_)*z /
+                (((((b1_*r+b2_)*r+b3_)*r+b4_)*r+b5_)*r+1.0);
+        }
+        // about 5% of the deviates fall in the tails
+        for (Size j=0; j<n; j++) {
+            if (u[j] < x_low_)
+                x[j] = tail(u[j]);
+            else if (u[j] > x_high_)
+                x[j] = -tail(1.0-u[j]);
+        }
+    }
+
+}
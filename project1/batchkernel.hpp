@@ -0,0 +1,73 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file batchkernel.hpp
+    \brief Vectorized kernels working on batches of paths
+*/
+
+#ifndef batch_kernel_hpp
+#define batch_kernel_hpp
+
+#include <ql/types.hpp>
+#include <boost/cstdint.hpp>
+
+namespace QuantLib {
+
+    /*! These loops work on contiguous arrays holding one value per
+        path.  They live in their own translation unit, compiled with
+        the flags needed for the vector versions of std::exp; the
+        rest of the code is not affected by those flags.  Each kernel
+        is built for AVX2 and for the baseline instruction set, the
+        version used being chosen at load time.
+    */
+
+    //! to[j] = from[j]*exp(drift + stdDev*dw[j]) for j in [0,n)
+    void logNormalStep(const Real* from, Real* to, const Real* dw, Size n,
+                       Real drift, Real stdDev);
+
+    //! prices[j] = discount*max(omega*(spots[j]-strike), 0) for j in [0,n)
+    void vanillaPayoff(const Real* spots, Size n, Real omega, Real strike,
+                       Real discount, Real* prices);
+
+    //! prices[j] *= exp(logScale - exponent*log(spots[j])) for j in [0,n)
+    /*! This is the likelihood ratio of a log-normal terminal value
+        sampled with a shifted Gaussian drift.
+    */
+    void importanceWeights(const Real* spots, Size n, Real logScale,
+                           Real exponent, Real* prices);
+
+    //! uniform deviates in (0,1) from the Philox4x32-10 generator
+    /*! Fills \c u with the 4*blocks outputs of the counters in
+        [counter, counter+blocks) under the given key.
+
+        See J. K. Salmon et al., "Parallel random numbers: as easy
+        as 1, 2, 3", SC11 (2011).
+    */
+    void philoxUniforms(boost::uint32_t key0, boost::uint32_t key1,
+                        boost::uint64_t counter, Size blocks, Real* u);
+
+    //! x[j] = inverse cumulative normal of u[j] for j in [0,n)
+    /*! Same rational approximation (by P. J. Acklam) as
+        InverseCumulativeNormal; the central region is computed by a
+        vectorized loop, the tails by a scalar pass.
+    */
+    void inverseCumulativeNormal(const Real* u, Size n, Real* x);
+
+}
+
+
+#endif
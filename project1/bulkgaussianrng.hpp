@@ -0,0 +1,123 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file bulkgaussianrng.hpp
+    \brief Gaussian sequences generated in bulk
+*/
+
+#ifndef bulk_gaussian_rng_hpp
+#define bulk_gaussian_rng_hpp
+
+#include "batchkernel.hpp"
+#include <ql/methods/montecarlo/sample.hpp>
+#include <ql/math/randomnumbers/seedgenerator.hpp>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Gaussian sequence generator filling large buffers at once
+    /*! Uniform deviates come from the counter-based Philox4x32-10
+        generator keyed by the seed, and are mapped to Gaussian ones
+        by the same inverse-cumulative approximation used by
+        InverseCumulativeNormal.  Both stages run over a whole buffer
+        in vectorized loops; sequences are then served from it.
+
+        Different seeds give different keys, hence independent
+        streams, which is what the parallel engines rely on.
+
+        \ingroup mcarlo
+    */
+    class BulkGaussianRsg {
+      public:
+        typedef Sample<std::vector<Real> > sample_type;
+        explicit BulkGaussianRsg(Size dimensionality,
+                                 BigNatural seed = 0,
+                                 Size bufferSize = 4096);
+        const sample_type& nextSequence() const;
+        const sample_type& lastSequence() const { return sequence_; }
+        Size dimension() const { return dimensionality_; }
+      private:
+        void refill() const;
+        Size dimensionality_;
+        boost::uint32_t key0_, key1_;
+        mutable boost::uint64_t counter_;
+        mutable std::vector<Real> uniforms_, normals_;
+        mutable Size position_;
+        mutable sample_type sequence_;
+    };
+
+
+    //! random-number policy using BulkGaussianRsg
+    /*! It can be passed as the \c RNG argument of the Monte Carlo
+        engines in place of PseudoRandom.
+    */
+    struct BulkPseudoRandom {
+        typedef BulkGaussianRsg rsg_type;
+        enum { allowsErrorEstimate = 1 };
+        static rsg_type make_sequence_generator(Size dimension,
+                                                BigNatural seed) {
+            return rsg_type(dimension, seed);
+        }
+    };
+
+
+    // inline definitions
+
+    inline BulkGaussianRsg::BulkGaussianRsg(Size dimensionality,
+                                            BigNatural seed,
+                                            Size bufferSize)
+    : dimensionality_(dimensionality), counter_(0),
+      uniforms_(4*((bufferSize+3)/4)), normals_(uniforms_.size()),
+      position_(normals_.size()),
+      sequence_(std::vector<Real>(dimensionality), 1.0) {
+        QL_REQUIRE(dimensionality > 0, "null dimensionality");
+        QL_REQUIRE(bufferSize > 0, "null buffer size");
+        if (seed == 0)
+            seed = SeedGenerator::instance().get();
+        key0_ = boost::uint32_t(seed);
+        key1_ = boost::uint32_t(boost::uint64_t(seed) >> 32);
+    }
+
+    inline const BulkGaussianRsg::sample_type&
+    BulkGaussianRsg::nextSequence() const {
+        Size i = 0;
+        while (i < dimensionality_) {
+            if (position_ == normals_.size())
+                refill();
+            Size n = std::min(dimensionality_-i, normals_.size()-position_);
+            std::copy(normals_.begin()+position_,
+                      normals_.begin()+position_+n,
+                      sequence_.value.begin()+i);
+            position_ += n;
+            i += n;
+        }
+        return sequence_;
+    }
+
+    inline void BulkGaussianRsg::refill() const {
+        Size blocks = uniforms_.size()/4;
+        philoxUniforms(key0_, key1_, counter_, blocks, &uniforms_[0]);
+        counter_ += blocks;
+        inverseCumulativeNormal(&uniforms_[0], uniforms_.size(),
+                                &normals_[0]);
+        position_ = 0;
+    }
+
+}
+
+
+#endif
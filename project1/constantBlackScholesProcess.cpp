@@ -67,5 +67,11 @@ namespace QuantLib {
 		return diffusion_*s;
 	}
 
+	Real constantBlackScholesProcess::evolve(Time t0, Real x0, Time dt, Real dw) const {
+		// with constant coefficients the log of the spot is Gaussian
+		return x0*std::exp((risk_drift - 0.5*diffusion_*diffusion_)*dt
+						   + diffusion_*std::sqrt(dt)*dw);
+	}
+
 
 }
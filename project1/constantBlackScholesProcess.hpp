@@ -58,6 +58,11 @@
 		Real x0() const;
 		Real drift(Time t, Real s) const;
 		Real diffusion(Time t, Real s) const;
+		//! exact log-normal step; the discretization is not used
+		Real evolve(Time t0, Real x0, Time dt, Real dw) const;
+		//! frozen coefficients
+		Real riskDrift() const { return risk_drift; }
+		Volatility volatility() const { return diffusion_; }
 		
 	};
 
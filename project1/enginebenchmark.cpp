@@ -0,0 +1,211 @@
+#include "constantBlackScholesProcess.hpp"
+#include "mceuropeanengine.hpp"
+#include "bulkgaussianrng.hpp"
+#include <ql/quantlib.hpp>
+#include <boost/chrono.hpp>
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+using namespace QuantLib;
+
+// Benchmarks MCEuropeanEngine_2 over a grid of settings.
+//
+// usage: enginebenchmark [csv|json] [trials]
+//
+// Each configuration is priced once to warm up (process caches,
+// term-structure calculations, page faults) and then timed over the
+// given number of trials; wall-clock times come from a steady clock.
+// Results are written to standard output, one record per setting.
+//
+// On the constant route, the batched sampling of withBatchSize() is
+// timed as well, with both PseudoRandom and BulkPseudoRandom; the
+// "speedup" field gives its throughput relative to the scalar route
+// (PseudoRandom, no batches) with the same other settings.
+
+struct Setting {
+    Size samples, steps;
+    bool brownianBridge, antitheticVariate, constant;
+    // Null<Size>() for the scalar route
+    Size batchSize;
+    bool bulk;
+};
+
+struct Measure {
+    Setting setting;
+    Size trials, sampledSteps;
+    double medianMs, minMs;
+    Real npv, errorEstimate, absoluteError;
+    double speedup;
+};
+
+template <class RNG>
+Measure run(const Setting& setting,
+            const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+            const boost::shared_ptr<StrikedTypePayoff>& payoff,
+            const boost::shared_ptr<Exercise>& exercise,
+            Real exact,
+            Size trials) {
+    VanillaOption option(payoff, exercise);
+    MakeMCEuropeanEngine_2<RNG> engine(process);
+    engine.withSteps(setting.steps)
+          .withSamples(setting.samples)
+          .withBrownianBridge(setting.brownianBridge)
+          .withAntitheticVariate(setting.antitheticVariate)
+          .withconstParameter(setting.constant)
+          .withSeed(42);
+    if (setting.batchSize != Null<Size>())
+        engine.withBatchSize(setting.batchSize);
+    option.setPricingEngine(engine);
+    option.NPV();
+
+    std::vector<double> times;
+    for (Size i=0; i<trials; i++) {
+        boost::chrono::steady_clock::time_point start =
+            boost::chrono::steady_clock::now();
+        option.recalculate();
+        boost::chrono::duration<double, boost::milli> elapsed =
+            boost::chrono::steady_clock::now() - start;
+        times.push_back(elapsed.count());
+    }
+    std::sort(times.begin(), times.end());
+
+    Measure m;
+    m.setting = setting;
+    m.trials = trials;
+    // the constant route samples the terminal value in one step
+    m.sampledSteps = setting.constant ? 1 : setting.steps;
+    m.medianMs = times[times.size()/2];
+    m.minMs = times.front();
+    m.npv = option.NPV();
+    m.errorEstimate = option.errorEstimate();
+    m.absoluteError = std::fabs(m.npv - exact);
+    m.speedup = 1.0;
+    return m;
+}
+
+void print(const std::vector<Measure>& measures, bool json) {
+    if (json)
+        std::cout << "[" << std::endl;
+    else
+        std::cout << "samples,steps,brownianBridge,antitheticVariate,"
+                  << "constant,batchSize,rng,trials,sampledSteps,"
+                  << "wallMsMedian,wallMsMin,samplesPerSecond,"
+                  << "nsPerPathStep,speedup,npv,errorEstimate,"
+                  << "absoluteError,varianceTimesSeconds" << std::endl;
+    for (Size i=0; i<measures.size(); i++) {
+        const Measure& m = measures[i];
+        const Setting& s = m.setting;
+        double seconds = m.medianMs/1000.0;
+        double samplesPerSecond = s.samples/seconds;
+        double nsPerPathStep = 1.0e9*seconds/(s.samples*m.sampledSteps);
+        // error per unit cost: the lower, the more efficient the
+        // setting, independently of the number of samples
+        double varianceTime = m.errorEstimate*m.errorEstimate*seconds;
+        const char* format = json ?
+            "  {\"samples\": %lu, \"steps\": %lu, \"brownianBridge\": %s, "
+            "\"antitheticVariate\": %s, \"constant\": %s, "
+            "\"batchSize\": %lu, \"rng\": \"%s\", \"trials\": %lu, "
+            "\"sampledSteps\": %lu, \"wallMsMedian\": %.4f, "
+            "\"wallMsMin\": %.4f, \"samplesPerSecond\": %.1f, "
+            "\"nsPerPathStep\": %.3f, \"speedup\": %.3f, \"npv\": %.8f, "
+            "\"errorEstimate\": %.8f, \"absoluteError\": %.8f, "
+            "\"varianceTimesSeconds\": %.6g}%s\n" :
+            "%lu,%lu,%s,%s,%s,%lu,%s,%lu,%lu,%.4f,%.4f,%.1f,%.3f,%.3f,%.8f,"
+            "%.8f,%.8f,%.6g%s\n";
+        const char* t = json ? "true" : "1";
+        const char* f = json ? "false" : "0";
+        printf(format,
+               (unsigned long)s.samples, (unsigned long)s.steps,
+               s.brownianBridge ? t : f, s.antitheticVariate ? t : f,
+               s.constant ? t : f,
+               (unsigned long)(s.batchSize != Null<Size>() ? s.batchSize : 0),
+               s.bulk ? "BulkPseudoRandom" : "PseudoRandom",
+               (unsigned long)m.trials,
+               (unsigned long)m.sampledSteps, m.medianMs, m.minMs,
+               samplesPerSecond, nsPerPathStep, m.speedup, m.npv,
+               m.errorEstimate,
+               m.absoluteError, varianceTime,
+               json && i+1 < measures.size() ? "," : "");
+    }
+    if (json)
+        std::cout << "]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    try {
+        bool json = (argc > 1 && std::strcmp(argv[1], "json") == 0);
+        QL_REQUIRE(argc < 2 || json || std::strcmp(argv[1], "csv") == 0,
+                   "usage: " << argv[0] << " [csv|json] [trials]");
+        Size trials = (argc > 2 ? std::atoi(argv[2]) : 5);
+        QL_REQUIRE(trials > 0, "at least one trial required");
+
+        Calendar calendar = TARGET();
+        DayCounter dayCounter = Actual365Fixed();
+        Date t0(1, March, 2019);
+        Date T(1, March, 2020);
+        Settings::instance().evaluationDate() = t0;
+        Real strike = 80;
+
+        // same market as main.cpp
+        Handle<YieldTermStructure> rate(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.05, dayCounter)));
+        Handle<Quote> underlying(boost::shared_ptr<Quote>(new SimpleQuote(100)));
+        Handle<BlackVolTermStructure> volatility(boost::shared_ptr<BlackVolTermStructure>(new BlackConstantVol(t0, calendar, 0.15, dayCounter)));
+        Handle<YieldTermStructure> dividend(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.03, dayCounter)));
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_BS(new GeneralizedBlackScholesProcess(underlying, dividend, rate, volatility));
+        boost::shared_ptr<Exercise> europeanExercise(new EuropeanExercise(T));
+        boost::shared_ptr<StrikedTypePayoff> payoff(new PlainVanillaPayoff(Option::Put, strike));
+
+        VanillaOption reference(payoff, europeanExercise);
+        reference.setPricingEngine(boost::shared_ptr<PricingEngine>(new AnalyticEuropeanEngine(process_BS)));
+        Real exact = reference.NPV();
+
+        Size samples[] = { 10000, 100000 };
+        Size steps[] = { 10, 100 };
+        std::vector<Measure> measures;
+        for (Size i=0; i<sizeof(samples)/sizeof(samples[0]); i++)
+            for (Size j=0; j<sizeof(steps)/sizeof(steps[0]); j++)
+                for (int flags=0; flags<8; flags++) {
+                    Setting setting = { samples[i], steps[j],
+                                        (flags & 1) != 0,
+                                        (flags & 2) != 0,
+                                        (flags & 4) != 0,
+                                        Null<Size>(), false };
+                    Measure scalar = run<PseudoRandom>(setting, process_BS,
+                                                       payoff,
+                                                       europeanExercise,
+                                                       exact, trials);
+                    measures.push_back(scalar);
+                    if (!setting.constant)
+                        continue;
+                    // batched route, same settings
+                    setting.batchSize = 1024;
+                    Measure batch = run<PseudoRandom>(setting, process_BS,
+                                                      payoff,
+                                                      europeanExercise,
+                                                      exact, trials);
+                    setting.bulk = true;
+                    Measure bulk = run<BulkPseudoRandom>(setting,
+                                                         process_BS, payoff,
+                                                         europeanExercise,
+                                                         exact, trials);
+                    batch.speedup = scalar.medianMs/batch.medianMs;
+                    bulk.speedup = scalar.medianMs/bulk.medianMs;
+                    measures.push_back(batch);
+                    measures.push_back(bulk);
+                }
+
+        print(measures, json);
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,89 @@
+#include "constantBlackScholesProcess.hpp"
+#include "pathgenerator.hpp"
+#include <ql/quantlib.hpp>
+#include <boost/chrono.hpp>
+#include <iostream>
+#include <cstdio>
+
+using namespace QuantLib;
+
+// Times the path evolution alone: the Gaussian increments are drawn
+// once beforehand, so that the figures compare the evolve kernels
+// and not the random-number generation.
+template <class P>
+double nanosecondsPerStep(const boost::shared_ptr<P>& process,
+                          const TimeGrid& grid,
+                          const std::vector<std::vector<Real> >& dw,
+                          Size repetitions,
+                          Real& checksum) {
+    PathEvolver_2<P> evolver(process, grid);
+    Path path(grid);
+    boost::chrono::steady_clock::time_point start =
+        boost::chrono::steady_clock::now();
+    for (Size k=0; k<repetitions; k++) {
+        for (Size j=0; j<dw.size(); j++) {
+            evolver.evolve(path, dw[j], false);
+            checksum += path.back();
+        }
+    }
+    boost::chrono::duration<double, boost::nano> elapsed =
+        boost::chrono::steady_clock::now() - start;
+    return elapsed.count() / (repetitions*dw.size()*(grid.size()-1));
+}
+
+int main() {
+
+    try {
+        Calendar calendar = TARGET();
+        DayCounter dayCounter = Actual365Fixed();
+        Date t0(1, March, 2019);
+        Date T(1, March, 2020);
+        Real strike = 80;
+
+        // same market as main.cpp
+        Handle<YieldTermStructure> rate(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.05, dayCounter)));
+        Handle<Quote> underlying(boost::shared_ptr<Quote>(new SimpleQuote(100)));
+        Handle<BlackVolTermStructure> volatility(boost::shared_ptr<BlackVolTermStructure>(new BlackConstantVol(t0, calendar, 0.15, dayCounter)));
+        Handle<YieldTermStructure> dividend(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.03, dayCounter)));
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_BS(new GeneralizedBlackScholesProcess(underlying, dividend, rate, volatility));
+        boost::shared_ptr<constantBlackScholesProcess> process_constant(
+            new constantBlackScholesProcess(underlying, T, strike, rate, volatility, dividend));
+
+        Size steps = 250, paths = 2000, repetitions = 10;
+        TimeGrid grid(dayCounter.yearFraction(t0, T), steps);
+        PseudoRandom::rsg_type generator =
+            PseudoRandom::make_sequence_generator(steps, 42);
+        std::vector<std::vector<Real> > dw(paths);
+        for (Size j=0; j<paths; j++)
+            dw[j] = generator.nextSequence().value;
+
+        Real checksum = 0.0;
+        // GeneralizedBlackScholesProcess, virtual evolve()
+        double generic = nanosecondsPerStep<StochasticProcess1D>(
+                                 process_BS, grid, dw, repetitions, checksum);
+        // constantBlackScholesProcess, still through virtual evolve()
+        double virtualConstant = nanosecondsPerStep<StochasticProcess1D>(
+                           process_constant, grid, dw, repetitions, checksum);
+        // constantBlackScholesProcess, specialized kernel
+        double kernel = nanosecondsPerStep<constantBlackScholesProcess>(
+                           process_constant, grid, dw, repetitions, checksum);
+
+        std::cout << steps << " steps, " << paths*repetitions << " paths"
+                  << std::endl;
+        printf("GeneralizedBlackScholesProcess   %8.2f ns/step\n", generic);
+        printf("constant process, virtual calls  %8.2f ns/step\n",
+               virtualConstant);
+        printf("constant process, inlined kernel %8.2f ns/step\n", kernel);
+        printf("speed-up vs generic route        %8.2fx\n", generic/kernel);
+        std::cout << "(checksum " << checksum << ")" << std::endl;
+
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
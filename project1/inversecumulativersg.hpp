@@ -0,0 +1,86 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file inversecumulativersg.hpp
+    \brief Allocation-free inverse-cumulative sequence generator
+*/
+
+#ifndef inverse_cumulative_rsg_2_hpp
+#define inverse_cumulative_rsg_2_hpp
+
+#include <ql/math/randomnumbers/rngtraits.hpp>
+
+namespace QuantLib {
+
+    //! Inverse cumulative random sequence generator
+    /*! Same as InverseCumulativeRsg, except that the uniform sequence
+        is read through a reference instead of being copied, which
+        saves a heap allocation per sequence.
+    */
+    template <class USG, class IC>
+    class InverseCumulativeRsg_2 {
+      public:
+        typedef Sample<std::vector<Real> > sample_type;
+        explicit InverseCumulativeRsg_2(const USG& uniformSequenceGenerator)
+        : uniformSequenceGenerator_(uniformSequenceGenerator),
+          dimension_(uniformSequenceGenerator_.dimension()),
+          x_(std::vector<Real> (dimension_), 1.0) {}
+        const sample_type& nextSequence() const {
+            const typename USG::sample_type& sample =
+                uniformSequenceGenerator_.nextSequence();
+            x_.weight = sample.weight;
+            for (Size i=0; i<dimension_; i++)
+                x_.value[i] = ICD_(sample.value[i]);
+            return x_;
+        }
+        const sample_type& lastSequence() const { return x_; }
+        Size dimension() const { return dimension_; }
+      private:
+        USG uniformSequenceGenerator_;
+        Size dimension_;
+        mutable sample_type x_;
+        IC ICD_;
+    };
+
+
+    //! sequence generator used by the Monte Carlo workers
+    /*! By default, the one provided by the random-number policy;
+        pseudo-random policies are mapped on InverseCumulativeRsg_2,
+        which returns the same sequences without allocating.
+    */
+    template <class RNG>
+    struct AllocationFreeRsg {
+        typedef typename RNG::rsg_type type;
+        static type make(Size dimension, BigNatural seed) {
+            return RNG::make_sequence_generator(dimension, seed);
+        }
+    };
+
+    template <class URNG, class IC>
+    struct AllocationFreeRsg<GenericPseudoRandom<URNG,IC> > {
+        typedef RandomSequenceGenerator<URNG> ursg_type;
+        typedef InverseCumulativeRsg_2<ursg_type,IC> type;
+        static type make(Size dimension, BigNatural seed) {
+            ursg_type g(dimension, seed);
+            return type(g);
+        }
+    };
+
+}
+
+
+#endif
@@ -1,5 +1,6 @@
 #include "constantBlackScholesProcess.hpp"
 #include "mceuropeanengine.hpp"
+#include "mceuropeanportfolio.hpp"
 #include <ql/pricingengines/vanilla/mceuropeanengine.hpp>
 #include <ql/quantlib.hpp>
 #include <time.h>
@@ -88,6 +89,75 @@ int main() {
 		printf("Temps d'execution: %.2fs\n", (double)(clock() - t_debut_2) / CLOCKS_PER_SEC);
 		std::cout << "Erreur d'estimation " << option_2.errorEstimate() << std::endl;
 		std::cout << "     " << std::endl;
+		std::cout << "MCEuropeanEngine avec variable de controle" << std::endl;
+		std::cout << "     " << std::endl;
+
+		// Avec une volatilite constante, le controle serait le processus simule
+		// lui-meme; on prend donc une volatilite croissante avec la maturite,
+		// que le controle remplace par sa moyenne jusqu'a l'echeance
+		std::vector<Date> volDates;
+		std::vector<Volatility> vols;
+		volDates.push_back(Date(1, June, 2019));      vols.push_back(0.10);
+		volDates.push_back(Date(1, September, 2019)); vols.push_back(0.13);
+		volDates.push_back(Date(1, December, 2019));  vols.push_back(0.16);
+		volDates.push_back(T);                        vols.push_back(0.20);
+		Handle<BlackVolTermStructure> volatilityCurve(boost::shared_ptr<BlackVolTermStructure>(new BlackVarianceCurve(t0, volDates, vols, dayCounter)));
+		boost::shared_ptr<GeneralizedBlackScholesProcess> process_TS(new GeneralizedBlackScholesProcess(underlying, dividend, rate, volatilityCurve));
+
+		option_1.setPricingEngine(boost::shared_ptr<PricingEngine>(new AnalyticEuropeanEngine(process_TS)));
+		std::cout << "Prix exact " << option_1.NPV() << std::endl;
+
+		option_1.setPricingEngine(MakeMCEuropeanEngine_2<PseudoRandom>(process_TS)
+									.withSteps(10)
+									.withBrownianBridge()
+									.withSamples(10000)
+									.withSeed(SeedGenerator::instance().get())
+									.withControlVariate());
+
+		std::cout << "Prix de l'option  " << option_1.NPV() << std::endl;
+		std::cout << "Erreur d'estimation " << option_1.errorEstimate() << std::endl;
+		std::cout << "Reduction de variance " << option_1.result<Real>("varianceReductionFactor") << std::endl;
+		std::cout << "     " << std::endl;
+		std::cout << "MCEuropeanEngine constant, antithetique et moment matching" << std::endl;
+		std::cout << "     " << std::endl;
+
+		option_2.setPricingEngine(MakeMCEuropeanEngine_2<PseudoRandom>(process_BS)
+									.withSteps(10)
+									.withSamples(10000)
+									.withSeed(SeedGenerator::instance().get())
+									.withconstParameter(true)
+									.withAntitheticVariate()
+									.withMomentMatching());
+
+		std::cout << "Prix de l'option  " << option_2.NPV() << std::endl;
+		std::cout << "Erreur d'estimation " << option_2.errorEstimate() << std::endl;
+		std::cout << "     " << std::endl;
+		std::cout << "MCEuropeanEngine constant, echantillonnage preferentiel" << std::endl;
+		std::cout << "     " << std::endl;
+
+		option_2.setPricingEngine(MakeMCEuropeanEngine_2<PseudoRandom>(process_BS)
+									.withSteps(10)
+									.withSamples(10000)
+									.withSeed(SeedGenerator::instance().get())
+									.withconstParameter(true)
+									.withImportanceSampling());
+
+		std::cout << "Prix de l'option  " << option_2.NPV() << std::endl;
+		std::cout << "Erreur d'estimation " << option_2.errorEstimate() << std::endl;
+		std::cout << "Decalage " << option_2.result<Real>("importanceSamplingShift") << std::endl;
+		std::cout << "     " << std::endl;
+		std::cout << "Portefeuille d'options avec les memes trajectoires" << std::endl;
+		std::cout << "     " << std::endl;
+
+		MCEuropeanPortfolio_2<PseudoRandom> portfolio(process_BS, 10, Null<Size>(), true, false,
+													  10000, SeedGenerator::instance().get());
+		for (Real k = 0.8*strike; k <= 1.2*strike; k += 0.1*strike)
+			portfolio.add(boost::shared_ptr<StrikedTypePayoff>(new PlainVanillaPayoff(type, k)), europeanExercise);
+
+		for (Size i = 0; i < portfolio.size(); i++)
+			std::cout << "Prix de l'option " << i << " " << portfolio.NPV(i)
+					  << " (erreur " << portfolio.errorEstimate(i) << ")" << std::endl;
+		std::cout << "     " << std::endl;
 
 		return 0;
 
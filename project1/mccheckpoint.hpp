@@ -0,0 +1,172 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file mccheckpoint.hpp
+    \brief Checkpoint files for long Monte Carlo simulations
+*/
+
+#ifndef mc_checkpoint_hpp
+#define mc_checkpoint_hpp
+
+#include "streamingstatistics.hpp"
+#include <boost/cstdint.hpp>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace QuantLib {
+
+    //! whether the state of a statistics policy can be checkpointed
+    /*! Only policies whose state has a constant size qualify, so
+        that saving a checkpoint costs the same whatever the number of
+        samples; with policies storing the samples, such as
+        Statistics, the total size written would grow with the square
+        of the number of samples.
+    */
+    template <class S>
+    struct Checkpointable {
+        enum { value = 0 };
+    };
+
+    template <>
+    struct Checkpointable<StreamingStatistics_2> {
+        enum { value = 1 };
+    };
+
+    //! policies whose state cannot be accessed cannot be checkpointed
+    template <class S>
+    void saveStatistics(std::ostream&, const S&) {
+        QL_FAIL("checkpoints not available for this statistics policy");
+    }
+
+    template <class S>
+    void loadStatistics(std::istream&, S&) {
+        QL_FAIL("checkpoints not available for this statistics policy");
+    }
+
+    inline void saveStatistics(std::ostream& out,
+                               const StreamingStatistics_2& stats) {
+        stats.save(out);
+    }
+
+    inline void loadStatistics(std::istream& in,
+                               StreamingStatistics_2& stats) {
+        stats.load(in);
+    }
+
+
+    //! checkpoint file of a simulation run in chunks
+    /*! The file holds the kind of the simulation, i.e., a name for
+        whatever is fixed at compile time, such as the random-number
+        and statistics policies; its signature, i.e., whatever numbers
+        determine its samples; the number of chunks completed; and
+        the statistics accumulated over them.  A checkpoint is only
+        loaded if its kind and signature match those of the running
+        simulation.
+
+        The file is written in native binary form; it is first
+        written under a temporary name and then renamed, so that a
+        crash while saving leaves the previous checkpoint intact.
+    */
+    class McCheckpoint_2 {
+      public:
+        McCheckpoint_2(const std::string& fileName,
+                       const std::string& kind,
+                       const std::vector<Real>& signature)
+        : fileName_(fileName), kind_(kind), signature_(signature) {}
+        //! returns the number of chunks completed, 0 if no file exists
+        template <class S>
+        Size load(S& stats) const;
+        template <class S>
+        void save(Size chunks, const S& stats) const;
+      private:
+        static const char* magic() { return "QLMCCKP2"; }
+        std::string fileName_, kind_;
+        std::vector<Real> signature_;
+    };
+
+
+    // template definitions
+
+    template <class S>
+    inline Size McCheckpoint_2::load(S& stats) const {
+        std::ifstream in(fileName_.c_str(), std::ios::binary);
+        if (!in)
+            return 0;
+        char magic[8];
+        boost::uint64_t length, n, chunks;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        QL_REQUIRE(in && std::memcmp(magic, McCheckpoint_2::magic(), 8) == 0,
+                   fileName_ << " is not a checkpoint file");
+        std::string kind(static_cast<Size>(length), ' ');
+        if (length > 0)
+            in.read(&kind[0], length);
+        QL_REQUIRE(in, "truncated checkpoint file " << fileName_);
+        QL_REQUIRE(kind == kind_,
+                   fileName_ << " belongs to a different kind of simulation");
+        in.read(reinterpret_cast<char*>(&n), sizeof(n));
+        QL_REQUIRE(in, "truncated checkpoint file " << fileName_);
+        std::vector<Real> signature(static_cast<Size>(n));
+        if (n > 0)
+            in.read(reinterpret_cast<char*>(&signature[0]),
+                    n*sizeof(Real));
+        in.read(reinterpret_cast<char*>(&chunks), sizeof(chunks));
+        QL_REQUIRE(in, "truncated checkpoint file " << fileName_);
+        QL_REQUIRE(signature == signature_,
+                   fileName_ << " belongs to a different simulation");
+        loadStatistics(in, stats);
+        return Size(chunks);
+    }
+
+    template <class S>
+    inline void McCheckpoint_2::save(Size chunks, const S& stats) const {
+        std::string temporary = fileName_ + ".tmp";
+        {
+            std::ofstream out(temporary.c_str(),
+                              std::ios::binary | std::ios::trunc);
+            QL_REQUIRE(out, "cannot write " << temporary);
+            boost::uint64_t length = kind_.size(), n = signature_.size(),
+                            c = chunks;
+            out.write(magic(), 8);
+            out.write(reinterpret_cast<const char*>(&length),
+                      sizeof(length));
+            out.write(kind_.data(), length);
+            out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+            if (n > 0)
+                out.write(reinterpret_cast<const char*>(&signature_[0]),
+                          n*sizeof(Real));
+            out.write(reinterpret_cast<const char*>(&c), sizeof(c));
+            saveStatistics(out, stats);
+            out.flush();
+            QL_REQUIRE(out, "error while writing " << temporary);
+        }
+        if (std::rename(temporary.c_str(), fileName_.c_str()) != 0) {
+            // on Windows, rename does not replace an existing file
+            std::remove(fileName_.c_str());
+            QL_REQUIRE(std::rename(temporary.c_str(),
+                                   fileName_.c_str()) == 0,
+                       "cannot rename " << temporary << " to " << fileName_);
+        }
+    }
+
+}
+
+
+#endif
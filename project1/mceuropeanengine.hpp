@@ -25,21 +25,118 @@
 
 
 #include "constantBlackScholesProcess.hpp" //! importation du fichier "constant"
+#include "montecarloworker.hpp"
+#include "inversecumulativersg.hpp"
+#include "randomizedlowdiscrepancy.hpp"
+#include "pathgenerator.hpp"
+#include "mccheckpoint.hpp"
 #include <ql/pricingengines/vanilla/mcvanillaengine.hpp>
 #include <ql/processes/eulerdiscretization.hpp>
+#include <ql/pricingengines/blackformula.hpp>
+#include <ql/math/solvers1d/brent.hpp>
 
 #include <ql/processes/blackscholesprocess.hpp>
 #include <ql/termstructures/volatility/equityfx/blackconstantvol.hpp>
 #include <ql/termstructures/volatility/equityfx/blackvariancecurve.hpp>
 #include <ql/quantlib.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/chrono.hpp>
+#include <boost/bind/bind.hpp>
+#include <typeinfo>
 
 
 
 
 namespace QuantLib {
 
+    class EuropeanPathPricer_2;
+    class EuropeanGreeksPathPricer_2;
+
     //! European option pricing engine using Monte Carlo simulation
     /*! \ingroup vanillaengines
+
+        When more than one thread is requested, the sample budget is
+        split across workers, each with its own path generator on a
+        random substream derived from the seed; their statistics are
+        merged in a fixed order, so that results are reproducible for
+        a given seed and number of threads.  Since the seed does not
+        change the points of a low-discrepancy sequence, several
+        threads require a policy allowing an error estimate, i.e.,
+        pseudo-random or randomized quasi-random numbers.
+
+        With constant parameters, a batch size can be given; paths
+        are then evolved and priced that many at a time in
+        structure-of-arrays layout, so that the updates vectorize.
+
+        As a control variate, the engine uses the same option priced
+        on paths of a constantBlackScholesProcess driven by the same
+        Gaussian draws; its expected value is the analytic
+        Black-Scholes price with the frozen coefficients.  The ratio
+        of the sample variances without and with the control is
+        returned as the "varianceReductionFactor" additional result.
+
+        With a randomized quasi-Monte Carlo policy, each worker uses
+        its own randomization of the sequence and draws the same
+        number of points, so that the sample count is rounded up to
+        a multiple of the number of randomizations; the error is
+        estimated from the spread of the worker means.  There is
+        exactly one worker per randomization, the workers being
+        shared among the threads, so that the results do not depend
+        on the number of threads.
+
+        With constant parameters, the sensitivities to all the inputs
+        of constantBlackScholesProcess can be estimated on the same
+        paths as the value, see EuropeanGreeksPathPricer_2.  Their
+        error estimates are returned as additional results named
+        after the greek, e.g., "deltaErrorEstimate"; with a
+        randomized policy, they come from the spread of the worker
+        means, as for the value.
+
+        A time budget, in milliseconds, can be given alone or together
+        with a tolerance or a number of samples.  Samples are then
+        drawn in fixed-size batches until the tolerance is met, the
+        number of samples is reached or the budget is used up,
+        whichever comes first; running out of time is not an error.
+        At least one batch is drawn, however small the budget.
+        In all modes, the number of samples actually drawn is
+        returned as the "samples" additional result.
+
+        With constant parameters, the Gaussian draws can also be
+        moment-matched across each batch of paths, alone or together
+        with antithetic variates; see BatchMonteCarloWorker_2.  If no
+        batch size is given, batches of 1024 paths are used.  The
+        error is then estimated from the spread of the batch means;
+        until two batches are available, the path-wise estimate, which
+        ignores the reduction, is returned instead.
+
+        For out-of-the-money options, importance sampling can be used
+        on the same route: the Gaussian draw of the terminal value is
+        shifted towards the exercise region by the amount returned by
+        europeanDriftShift(), and the path pricer weights each price
+        by the likelihood ratio.  The shift is returned as the
+        "importanceSamplingShift" additional result.
+
+        Long simulations with a fixed number of samples can be
+        checkpointed: they are then run in chunks of the given size,
+        and after each chunk the accumulated statistics are saved to
+        a file together with the number of chunks done; see
+        McCheckpoint_2.  If the file exists when the calculation
+        starts, the simulation resumes after the last saved chunk.
+        Each chunk draws its random numbers from a seed that depends
+        only on the engine seed and on the chunk index, so that a
+        resumed run gives the same results as an uninterrupted one;
+        checkpoints therefore require pseudo-random numbers.
+        The file is kept at the end; it must be removed to start
+        afresh.  The statistics policy must be StreamingStatistics_2,
+        whose checkpoints take a few dozen bytes whatever the number
+        of samples.
+
+        When compiled with MC_ENABLE_INSTRUMENTATION defined, the
+        engine also counts the ticks spent in each phase of the last
+        calculation, see McCounters_2; they are returned by
+        instrumentation() and as additional results named after the
+        phase, e.g., "rngTicks" and "rngCount".
+
         \test the correctness of the returned value is tested by
               checking it against analytic results.
     */
@@ -67,44 +164,156 @@ namespace QuantLib {
              Real requiredTolerance,
              Size maxSamples,
              BigNatural seed,
-             bool constant); //! définition du constructeur de la classe MCEuropeanEngine_2 avec en paramètre ajout du booléen
-             
+             bool constant,
+             Size threads = 1,
+             Size batchSize = Null<Size>(),
+             bool controlVariate = false,
+             bool greeks = false,
+             Real timeBudget = Null<Real>(),
+             bool momentMatching = false,
+             bool importanceSampling = false,
+             const std::string& checkpointFile = std::string(),
+             Size checkpointInterval = Null<Size>()); //! définition du constructeur de la classe MCEuropeanEngine_2 avec en paramètre ajout du booléen
+
+        void calculate() const;
+        void update();
+        #ifdef MC_ENABLE_INSTRUMENTATION
+        //! per-phase counters of the last calculation
+        McCounters_2 instrumentation() const;
+        #endif
       protected:
         boost::shared_ptr<path_pricer_type> pathPricer() const;
-       
+        boost::shared_ptr<EuropeanPathPricer_2>
+        europeanPathPricer(Real shift = 0.0) const;
+        // importance sampling
+        Real importanceSamplingShift() const;
+        typedef MonteCarloWorker_2<S> worker_type;
+        typedef typename AllocationFreeRsg<RNG>::type sequence_generator_type;
+        typedef PathGenerator_2<sequence_generator_type>
+            worker_path_generator_type;
+        typedef PathGenerator_2<sequence_generator_type,
+                                constantBlackScholesProcess>
+            constant_path_generator_type;
+        typedef ControlVariateMonteCarloWorker_2<worker_path_generator_type,
+                                                 constant_path_generator_type,
+                                                 S> control_worker_type;
+        typedef BatchMonteCarloWorker_2<sequence_generator_type,
+                                        EuropeanPathPricer_2,
+                                        S> batch_worker_type;
+        // parallel sampling
+        boost::shared_ptr<worker_type> worker(BigNatural seed) const;
+        std::vector<BigNatural> substreamSeeds(Size n,
+                                               BigNatural seed) const;
+        void addSamples(Size samples) const;
+        // checkpointing
+        S addSamplesWithCheckpoints() const;
+        std::vector<Real> checkpointSignature(Size chunkSize) const;
+        S sampleAccumulator() const;
+        Real errorEstimate() const;
+        void addSamplesWithinBudget() const;
+        S uncontrolledAccumulator() const;
+        // control variate
+        Real controlVariateValue() const;
+        // sensitivities
+        boost::shared_ptr<EuropeanGreeksPathPricer_2>
+        greeksPathPricer() const;
+        S sensitivityAccumulator(Size i) const;
+        Real sensitivityErrorEstimate(Size i) const;
+        static void runWorkers(
+                  const std::vector<boost::shared_ptr<worker_type> >* workers,
+                  const std::vector<Size>* samples,
+                  Size first, Size stride,
+                  std::vector<std::string>* errors);
+        mutable std::vector<boost::shared_ptr<worker_type> > workers_;
+        // kept to avoid casting process_ on every calculation
+        boost::shared_ptr<GeneralizedBlackScholesProcess>
+            blackScholesProcess_;
+
       private: 
         bool constant_; //! définition de l'attribut boolean
+        Size threads_;
+        Size batchSize_;
+        bool greeks_;
+        Real timeBudget_;
+        bool momentMatching_, importanceSampling_;
+        std::string checkpointFile_;
+        Size checkpointInterval_;
+        // cached to avoid lookups on every calculation
+        mutable boost::shared_ptr<constantBlackScholesProcess>
+            constantProcess_;
+        mutable Date constantExerciseDate_;
+        mutable Real constantStrike_;
+        #ifdef MC_ENABLE_INSTRUMENTATION
+        mutable McCounters_2 setupCounters_;
+        #endif
       public: //! surcharge de la méthode pathGenerator() de la classe MCVanillaEngine
         
         boost::shared_ptr<path_generator_type> pathGenerator() const {
+            return pathGenerator(this->seed_);
+        }
+
+        boost::shared_ptr<path_generator_type> pathGenerator(
+                                                   BigNatural seed) const {
 			Size dimensions = this->process_->factors();
-			TimeGrid grid = this->timeGrid();
+			TimeGrid grid = samplingGrid();
 			typename RNG::rsg_type generator =
-					RNG::make_sequence_generator(dimensions*(grid.size()-1),this->seed_);
-					
+					RNG::make_sequence_generator(dimensions*(grid.size()-1),seed);
+
 			if (this->constant_ ){
-				boost::shared_ptr<GeneralizedBlackScholesProcess> process =boost::dynamic_pointer_cast<GeneralizedBlackScholesProcess>(this->process_);
-				boost::shared_ptr<PlainVanillaPayoff> payoff = boost::dynamic_pointer_cast<PlainVanillaPayoff>(this->arguments_.payoff);
-                QL_REQUIRE(payoff, "non-plain payoff given");
 				return boost::shared_ptr<path_generator_type>(
-                                        new path_generator_type(boost::shared_ptr<constantBlackScholesProcess> (
-                                        new constantBlackScholesProcess(process->stateVariable(),
-                                        this->arguments_.exercise->lastDate(),
-                                        payoff->strike(),
-                                        process->riskFreeRate(),
-
-                                        process->blackVolatility(), 
-                                        process->dividendYield()
-                                                                )),grid,
+					new path_generator_type(constantProcess(), grid,
 											generator, this->brownianBridge_));
-                                  }	
-			
+			}
+
 			else{
 				return boost::shared_ptr<path_generator_type>(
 					new path_generator_type(this->process_, grid
-											,generator, this->brownianBridge_));				
-                 }				
+											,generator, this->brownianBridge_));
 			}
+		}
+
+      protected:
+        //! grid on which paths are actually sampled
+        TimeGrid samplingGrid() const {
+            TimeGrid grid = this->timeGrid();
+            // the pricer only reads the terminal value and the frozen
+            // coefficients allow an exact log-normal step: one step,
+            // one Gaussian draw and no discretization bias.
+            if (constant_)
+                return TimeGrid(grid.back(), 1);
+            return grid;
+        }
+
+        //! process with coefficients frozen at the exercise date
+        /*! It is built once and reused until the option changes or
+            the process notifies a change of its inputs.
+        */
+        boost::shared_ptr<constantBlackScholesProcess>
+        constantProcess() const {
+            boost::shared_ptr<PlainVanillaPayoff> payoff =
+                boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                                                    this->arguments_.payoff);
+            QL_REQUIRE(payoff, "non-plain payoff given");
+            Date exerciseDate = this->arguments_.exercise->lastDate();
+            if (!constantProcess_ ||
+                exerciseDate != constantExerciseDate_ ||
+                payoff->strike() != constantStrike_) {
+                const boost::shared_ptr<GeneralizedBlackScholesProcess>&
+                    process = blackScholesProcess_;
+                constantProcess_ =
+                    boost::shared_ptr<constantBlackScholesProcess>(
+                        new constantBlackScholesProcess(
+                                        process->stateVariable(),
+                                        exerciseDate,
+                                        payoff->strike(),
+                                        process->riskFreeRate(),
+                                        process->blackVolatility(),
+                                        process->dividendYield()));
+                constantExerciseDate_ = exerciseDate;
+                constantStrike_ = payoff->strike();
+            }
+            return constantProcess_;
+        }
     };
  
  
@@ -128,16 +337,30 @@ namespace QuantLib {
         MakeMCEuropeanEngine_2& withSeed(BigNatural seed);
         MakeMCEuropeanEngine_2& withAntitheticVariate(bool b = true);
         MakeMCEuropeanEngine_2& withconstParameter (bool constant);
+        MakeMCEuropeanEngine_2& withThreads(Size threads);
+        MakeMCEuropeanEngine_2& withBatchSize(Size batchSize);
+        MakeMCEuropeanEngine_2& withControlVariate(bool b = true);
+        MakeMCEuropeanEngine_2& withGreeks(bool b = true);
+        MakeMCEuropeanEngine_2& withTimeBudget(Real milliseconds);
+        MakeMCEuropeanEngine_2& withMomentMatching(bool b = true);
+        MakeMCEuropeanEngine_2& withImportanceSampling(bool b = true);
+        MakeMCEuropeanEngine_2& withCheckpoint(
+                                     const std::string& fileName,
+                                     Size interval = Null<Size>());
         // conversion to pricing engine
         operator boost::shared_ptr<PricingEngine>() const;
       private:
         boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
         bool antithetic_;
         Size steps_, stepsPerYear_, samples_, maxSamples_;
-        Real tolerance_;
-        bool brownianBridge_;
+        Real tolerance_, timeBudget_;
+        bool brownianBridge_, controlVariate_, greeks_, momentMatching_,
+             importanceSampling_;
         BigNatural seed_;
         bool constant_;
+        Size threads_, batchSize_;
+        std::string checkpointFile_;
+        Size checkpointInterval_;
     };
 
     class EuropeanPathPricer_2 : public PathPricer<Path> {
@@ -145,10 +368,83 @@ namespace QuantLib {
         EuropeanPathPricer_2(Option::Type type,
                              Real strike,
                              DiscountFactor discount);
+        //! pricer for paths sampled with a shifted Gaussian draw
+        /*! The terminal value must be
+            \f[ S_T = S_0 \exp(m + s Y) \f]
+            with \f$ Y \f$ drawn from \f$ N(\theta, 1) \f$ instead of
+            \f$ N(0, 1) \f$; each price is then multiplied by the
+            likelihood ratio \f$ \exp(-\theta Y + \theta^2/2) \f$.
+        */
+        EuropeanPathPricer_2(Option::Type type,
+                             Real strike,
+                             DiscountFactor discount,
+                             Real x0,
+                             Real logDrift,
+                             Real logStdDev,
+                             Real shift);
         Real operator()(const Path& path) const;
+        //! prices a batch of paths given their terminal values
+        void operator()(const Real* terminalValues,
+                        Size n,
+                        Real* prices) const;
       private:
         PlainVanillaPayoff payoff_;
         DiscountFactor discount_;
+        // the likelihood ratio is exp(logScale_ - exponent_*log(S_T))
+        Real logScale_, exponent_;
+    };
+
+
+    //! Gaussian shift for importance sampling of a European option
+    /*! For the terminal value \f$ S_0 \exp(m + s z) \f$, returns
+        the point of the exercise region maximizing the integrand
+        \f$ \log f(z) - z^2/2 \f$, where \f$ f \f$ is the payoff;
+        see P. Glasserman, P. Heidelberger and P. Shahabuddin,
+        "Asymptotically optimal importance sampling and
+        stratification for pricing path-dependent options",
+        Mathematical Finance 9 (1999).
+    */
+    Real europeanDriftShift(Option::Type type,
+                            Real strike,
+                            Real x0,
+                            Real logDrift,
+                            Real logStdDev);
+
+    //! sensitivities of a European option estimated on a path
+    /*! The path must be generated by a constantBlackScholesProcess
+        with the given coefficients, so that its terminal value is
+        \f[ S_T = S_0 \exp((r - q - \sigma^2/2)T + \sigma\sqrt{T} Z) \f]
+        and the Gaussian draw \f$ Z \f$ can be recovered from it.
+
+        The first-order sensitivities, i.e., to the spot quote, the
+        volatility and the risk-free and dividend zero rates at the
+        exercise date, are obtained by a hand-written reverse pass
+        through the computation of the discounted payoff; they all
+        come out of the same pass, so that their cost does not grow
+        with their number.  Gamma is the pathwise delta weighted by
+        the score of the terminal density with respect to
+        \f$ S_0 \f$, which has a much lower variance than the pure
+        likelihood-ratio estimator.
+    */
+    class EuropeanGreeksPathPricer_2 : public PathSensitivityPricer_2<Path> {
+      public:
+        enum Greek { Delta, Gamma, Vega, Rho, DividendRho, Greeks };
+        EuropeanGreeksPathPricer_2(Option::Type type,
+                                   Real strike,
+                                   Real x0,
+                                   Rate riskFreeRate,
+                                   Rate dividendYield,
+                                   Volatility volatility,
+                                   Time maturity);
+        Size size() const { return Greeks; }
+        void operator()(const Path& path, Real* greeks) const;
+      private:
+        Real omega_, strike_, x0_;
+        Rate riskFreeRate_, dividendYield_;
+        Volatility volatility_;
+        Time maturity_;
+        DiscountFactor discount_;
+        Real stdDev_;
     };
 
 
@@ -166,18 +462,598 @@ namespace QuantLib {
              Real requiredTolerance,
              Size maxSamples,
              BigNatural seed,
-             bool constant) //! définition du constructeur de la classe MCEuropeanEngine_2 qui hérite de MCVanillaEngine
+             bool constant,
+             Size threads,
+             Size batchSize,
+             bool controlVariate,
+             bool greeks,
+             Real timeBudget,
+             bool momentMatching,
+             bool importanceSampling,
+             const std::string& checkpointFile,
+             Size checkpointInterval) //! définition du constructeur de la classe MCEuropeanEngine_2 qui hérite de MCVanillaEngine
     : MCVanillaEngine<SingleVariate,RNG,S>(process,
                                            timeSteps,
                                            timeStepsPerYear,
                                            brownianBridge,
                                            antitheticVariate,
-                                           false,
+                                           controlVariate,
                                            requiredSamples,
                                            requiredTolerance,
                                            maxSamples,
-                                           seed) {
+                                           seed),
+      blackScholesProcess_(process) {
                                            constant_ = constant; //! initialisation de constant_
+        QL_REQUIRE(threads > 0, "at least one thread required");
+        // the workers of a low-discrepancy sequence would draw the
+        // same points whatever their seed
+        QL_REQUIRE(threads == 1 || RNG::allowsErrorEstimate,
+                   "several threads not available with non-randomized "
+                   "low-discrepancy sequences");
+        threads_ = threads;
+        QL_REQUIRE(batchSize == Null<Size>() || constant,
+                   "batched sampling requires constant parameters");
+        QL_REQUIRE(batchSize == Null<Size>() || batchSize > 0,
+                   "null batch size");
+        batchSize_ = batchSize;
+        // with constant parameters the control would be the price itself
+        QL_REQUIRE(!(controlVariate && constant),
+                   "control variate not available with constant parameters");
+        QL_REQUIRE(!greeks || constant,
+                   "greeks require constant parameters");
+        QL_REQUIRE(!greeks || batchSize == Null<Size>(),
+                   "greeks not available with batched sampling");
+        greeks_ = greeks;
+        QL_REQUIRE(timeBudget == Null<Real>() || timeBudget > 0.0,
+                   "non-positive time budget given");
+        timeBudget_ = timeBudget;
+        QL_REQUIRE(!momentMatching || constant,
+                   "moment matching requires constant parameters");
+        QL_REQUIRE(!(momentMatching && greeks),
+                   "greeks not available with moment matching");
+        momentMatching_ = momentMatching;
+        QL_REQUIRE(!importanceSampling || constant,
+                   "importance sampling requires constant parameters");
+        QL_REQUIRE(!(importanceSampling && greeks),
+                   "greeks not available with importance sampling");
+        importanceSampling_ = importanceSampling;
+        // only the value is carried from one chunk to the next
+        QL_REQUIRE(checkpointFile.empty() ||
+                   !(greeks || controlVariate || momentMatching),
+                   "checkpoints not available with greeks, control "
+                   "variate or moment matching");
+        QL_REQUIRE(checkpointFile.empty() || timeBudget == Null<Real>(),
+                   "checkpoints not available with a time budget");
+        QL_REQUIRE(checkpointFile.empty() || Checkpointable<S>::value,
+                   "checkpoints require a statistics policy of constant "
+                   "size, such as StreamingStatistics_2");
+        QL_REQUIRE(checkpointInterval == Null<Size>() ||
+                   checkpointInterval > 0,
+                   "null checkpoint interval");
+        checkpointFile_ = checkpointFile;
+        checkpointInterval_ = checkpointInterval;
+    }
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::update() {
+        // the frozen coefficients may be stale
+        constantProcess_.reset();
+        MCVanillaEngine<SingleVariate,RNG,S>::update();
+    }
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::calculate() const {
+        QL_REQUIRE(this->requiredTolerance_ != Null<Real>() ||
+                   this->requiredSamples_ != Null<Size>() ||
+                   timeBudget_ != Null<Real>(),
+                   "neither tolerance, number of samples "
+                   "nor time budget set");
+
+        if (threads_ > 1) {
+            // trigger the lazy calculations of the process and of its
+            // term structures before they are shared across threads
+            const boost::shared_ptr<GeneralizedBlackScholesProcess>&
+                process = blackScholesProcess_;
+            TimeGrid grid = this->timeGrid();
+            process->evolve(grid[0], process->x0(), grid.dt(0), 0.0);
+        }
+
+        if (!checkpointFile_.empty()) {
+            S stats = addSamplesWithCheckpoints();
+            this->results_.value = stats.mean();
+            this->results_.additionalResults["samples"] = stats.samples();
+            if (RNG::allowsErrorEstimate)
+                this->results_.errorEstimate = stats.errorEstimate();
+            return;
+        }
+
+        // one worker per randomization, whatever the number of
+        // threads; otherwise, one per thread
+        Size n = (Randomizations<RNG>::value > 0 ?
+                  Size(Randomizations<RNG>::value) : threads_);
+        std::vector<BigNatural> seeds = substreamSeeds(n, this->seed_);
+        workers_.clear();
+        #ifdef MC_ENABLE_INSTRUMENTATION
+        setupCounters_.reset();
+        #endif
+        for (Size i=0; i<n; i++) {
+            MC_PHASE_TIMER(setupCounters_, McSetup, 1);
+            workers_.push_back(worker(seeds[i]));
+        }
+
+        if (timeBudget_ != Null<Real>()) {
+            addSamplesWithinBudget();
+        } else if (this->requiredTolerance_ != Null<Real>()) {
+            // same sample-size schedule as McSimulation::value()
+            Size minSamples = 1023;
+            Size maxSamples = (this->maxSamples_ != Null<Size>() ?
+                               this->maxSamples_ : Size(QL_MAX_INTEGER));
+            addSamples(minSamples);
+            Size sampleNumber = minSamples;
+            Real error = errorEstimate();
+            while (error > this->requiredTolerance_) {
+                QL_REQUIRE(sampleNumber<maxSamples,
+                           "max number of samples (" << maxSamples
+                           << ") reached, while error (" << error
+                           << ") is still above tolerance ("
+                           << this->requiredTolerance_ << ")");
+                Real order = (error*error)/this->requiredTolerance_
+                                          /this->requiredTolerance_;
+                Size nextBatch =
+                    Size(std::max<Real>(static_cast<Real>(sampleNumber)*
+                                        order*0.8 - sampleNumber,
+                                        static_cast<Real>(minSamples)));
+                nextBatch = std::min(nextBatch, maxSamples-sampleNumber);
+                sampleNumber += nextBatch;
+                addSamples(nextBatch);
+                error = errorEstimate();
+            }
+        } else {
+            addSamples(this->requiredSamples_);
+        }
+
+        S stats = sampleAccumulator();
+        this->results_.value = stats.mean();
+        this->results_.additionalResults["samples"] = stats.samples();
+        if (RNG::allowsErrorEstimate)
+            this->results_.errorEstimate = errorEstimate();
+        if (importanceSampling_)
+            this->results_.additionalResults["importanceSamplingShift"] =
+                importanceSamplingShift();
+        if (this->controlVariate_ && stats.variance() > 0.0)
+            this->results_.additionalResults["varianceReductionFactor"] =
+                uncontrolledAccumulator().variance()/stats.variance();
+        #ifdef MC_ENABLE_INSTRUMENTATION
+        McCounters_2 counters = instrumentation();
+        for (Size i=0; i<McPhases; i++) {
+            McPhase phase = McPhase(i);
+            std::string name = mcPhaseName(phase);
+            this->results_.additionalResults[name + "Ticks"] =
+                Real(counters.ticks(phase));
+            this->results_.additionalResults[name + "Count"] =
+                counters.count(phase);
+        }
+        #endif
+
+        if (greeks_) {
+            typedef EuropeanGreeksPathPricer_2 greeks;
+            Real* results[] = {
+                &this->results_.delta, &this->results_.gamma,
+                &this->results_.vega, &this->results_.rho,
+                &this->results_.dividendRho
+            };
+            const char* names[] = {
+                "deltaErrorEstimate", "gammaErrorEstimate",
+                "vegaErrorEstimate", "rhoErrorEstimate",
+                "dividendRhoErrorEstimate"
+            };
+            for (Size i=0; i<greeks::Greeks; i++) {
+                S stats = sensitivityAccumulator(i);
+                *results[i] = stats.mean();
+                if (RNG::allowsErrorEstimate)
+                    this->results_.additionalResults[names[i]] =
+                        sensitivityErrorEstimate(i);
+            }
+        }
+    }
+
+
+    #ifdef MC_ENABLE_INSTRUMENTATION
+    template <class RNG, class S>
+    inline McCounters_2 MCEuropeanEngine_2<RNG,S>::instrumentation() const {
+        McCounters_2 counters = setupCounters_;
+        for (Size i=0; i<workers_.size(); i++)
+            counters += workers_[i]->counters();
+        return counters;
+    }
+    #endif
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::addSamplesWithinBudget() const {
+        typedef boost::chrono::steady_clock clock;
+        clock::time_point deadline = clock::now() +
+            boost::chrono::microseconds(
+                static_cast<boost::int_least64_t>(timeBudget_*1000.0));
+
+        Size maxSamples = Size(QL_MAX_INTEGER);
+        if (this->requiredSamples_ != Null<Size>())
+            maxSamples = this->requiredSamples_;
+        else if (this->maxSamples_ != Null<Size>())
+            maxSamples = this->maxSamples_;
+        Real tolerance = this->requiredTolerance_;
+
+        // small enough to poll the clock often, large enough for the
+        // threads to be worth starting
+        const Size batchSize = 1024*workers_.size();
+        Size sampleNumber = 0, nextCheck = 0;
+        // the first batch is drawn whatever the budget, so that there
+        // is always an estimate to return
+        do {
+            Size batch = std::min(batchSize, maxSamples-sampleNumber);
+            addSamples(batch);
+            sampleNumber += batch;
+            if (tolerance != Null<Real>() && sampleNumber >= nextCheck) {
+                // estimating the error can cost as much as a batch;
+                // it is checked again when the current trend says
+                // that the tolerance should be met, as in
+                // McSimulation::value()
+                Real error = errorEstimate();
+                if (error <= tolerance)
+                    break;
+                Real order = (error*error)/tolerance/tolerance;
+                nextCheck = sampleNumber + Size(std::max<Real>(
+                            static_cast<Real>(sampleNumber)*order*0.8
+                                                           - sampleNumber,
+                            static_cast<Real>(batchSize)));
+            }
+        } while (sampleNumber < maxSamples && clock::now() < deadline);
+    }
+
+
+    template <class RNG, class S>
+    inline boost::shared_ptr<typename MCEuropeanEngine_2<RNG,S>::worker_type>
+    MCEuropeanEngine_2<RNG,S>::worker(BigNatural seed) const {
+        typedef sequence_generator_type generator;
+        TimeGrid grid = samplingGrid();
+        generator sequences =
+            AllocationFreeRsg<RNG>::make(grid.size()-1, seed);
+
+        if (batchSize_ != Null<Size>() || momentMatching_ ||
+            importanceSampling_) {
+            Size batchSize = (batchSize_ != Null<Size>() ? batchSize_ : 1024);
+            Real shift = importanceSampling_ ? importanceSamplingShift() : 0.0;
+            return boost::shared_ptr<worker_type>(
+                new batch_worker_type(constantProcess(), grid, sequences,
+                                      this->brownianBridge_,
+                                      europeanPathPricer(shift),
+                                      this->antitheticVariate_, batchSize,
+                                      momentMatching_, shift));
+        } else if (constant_) {
+            // statically-typed process, so that the path is evolved
+            // by the specialized kernel instead of virtual calls
+            boost::shared_ptr<constant_path_generator_type> pathGenerator(
+                new constant_path_generator_type(constantProcess(), grid,
+                                                 sequences,
+                                                 this->brownianBridge_));
+            boost::shared_ptr<PathSensitivityPricer_2<Path> > greeks;
+            if (greeks_)
+                greeks = greeksPathPricer();
+            return boost::shared_ptr<worker_type>(
+                new PathMonteCarloWorker_2<constant_path_generator_type,S>(
+                    pathGenerator, pathPricer(), this->antitheticVariate_,
+                    greeks));
+        } else {
+            boost::shared_ptr<worker_path_generator_type> pathGenerator(
+                new worker_path_generator_type(blackScholesProcess_, grid,
+                                               sequences,
+                                               this->brownianBridge_));
+            if (!this->controlVariate_)
+                return boost::shared_ptr<worker_type>(
+                    new PathMonteCarloWorker_2<worker_path_generator_type,S>(
+                        pathGenerator, pathPricer(),
+                        this->antitheticVariate_));
+
+            // same seed, hence same Gaussian draws as the priced paths
+            boost::shared_ptr<constant_path_generator_type> cvPathGenerator(
+                new constant_path_generator_type(
+                              constantProcess(), grid,
+                              AllocationFreeRsg<RNG>::make(grid.size()-1,
+                                                           seed),
+                              this->brownianBridge_));
+            return boost::shared_ptr<worker_type>(
+                new control_worker_type(pathGenerator, pathPricer(),
+                                        cvPathGenerator, pathPricer(),
+                                        controlVariateValue(),
+                                        this->antitheticVariate_));
+        }
+    }
+
+
+    template <class RNG, class S>
+    inline std::vector<BigNatural>
+    MCEuropeanEngine_2<RNG,S>::substreamSeeds(Size n,
+                                              BigNatural seed) const {
+        // a single worker keeps the engine seed, so that the serial
+        // engine reproduces McSimulation; otherwise each worker gets
+        // a seed drawn from a generator seeded with it.
+        std::vector<BigNatural> seeds(n, seed);
+        if (n > 1) {
+            MersenneTwisterUniformRng seeder(seed);
+            for (Size i=0; i<n; i++) {
+                do {
+                    seeds[i] = seeder.nextInt32();
+                } while (seeds[i] == 0); // 0 would mean a random seed
+            }
+        }
+        return seeds;
+    }
+
+
+    template <class RNG, class S>
+    inline S MCEuropeanEngine_2<RNG,S>::addSamplesWithCheckpoints() const {
+        QL_REQUIRE(this->requiredSamples_ != Null<Size>(),
+                   "checkpoints require a fixed number of samples");
+        QL_REQUIRE(Randomizations<RNG>::value == 0,
+                   "checkpoints not available with randomized "
+                   "low-discrepancy sequences");
+        // each chunk would draw the same leading points again
+        QL_REQUIRE(RNG::allowsErrorEstimate,
+                   "checkpoints not available with low-discrepancy "
+                   "sequences");
+        // a null seed would give different draws after resuming
+        QL_REQUIRE(this->seed_ != 0, "checkpoints require a non-null seed");
+
+        Size samples = this->requiredSamples_;
+        Size chunkSize = (checkpointInterval_ != Null<Size>() ?
+                          checkpointInterval_ : Size(1048576));
+        Size chunks = (samples + chunkSize - 1)/chunkSize;
+        // the policies determine the draws and the layout of the
+        // statistics; they are told apart by the type of the engine
+        McCheckpoint_2 checkpoint(checkpointFile_,
+                                  typeid(MCEuropeanEngine_2).name(),
+                                  checkpointSignature(chunkSize));
+        S stats;
+        Size done = checkpoint.load(stats);
+        QL_REQUIRE(done <= chunks, "corrupted checkpoint: " << done
+                   << " chunks done out of " << chunks);
+
+        // the chunk seeds are drawn in sequence from the engine seed,
+        // whatever the chunk the simulation resumes from
+        MersenneTwisterUniformRng seeder(this->seed_);
+        for (Size k=0; k<chunks; k++) {
+            BigNatural seed;
+            do {
+                seed = seeder.nextInt32();
+            } while (seed == 0);
+            if (k < done)
+                continue;
+
+            std::vector<BigNatural> seeds = substreamSeeds(threads_, seed);
+            workers_.clear();
+            for (Size i=0; i<threads_; i++)
+                workers_.push_back(worker(seeds[i]));
+            addSamples(std::min(chunkSize, samples - k*chunkSize));
+            for (Size i=0; i<workers_.size(); i++)
+                mergeStatistics(stats, workers_[i]->sampleAccumulator());
+            checkpoint.save(k+1, stats);
+        }
+        return stats;
+    }
+
+
+    template <class RNG, class S>
+    inline std::vector<Real>
+    MCEuropeanEngine_2<RNG,S>::checkpointSignature(Size chunkSize) const {
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                this->arguments_.payoff);
+        QL_REQUIRE(payoff, "non-plain payoff given");
+        const boost::shared_ptr<GeneralizedBlackScholesProcess>& process =
+            blackScholesProcess_;
+        TimeGrid grid = this->timeGrid();
+        Time maturity = grid.back();
+
+        // whatever determines the samples drawn, besides the policies
+        Real signature[] = {
+            Real(this->seed_), Real(this->requiredSamples_),
+            Real(chunkSize), Real(threads_), Real(grid.size()),
+            Real(this->brownianBridge_), Real(this->antitheticVariate_),
+            Real(constant_), Real(batchSize_ != Null<Size>() ? batchSize_ : 0),
+            Real(importanceSampling_), Real(payoff->optionType()),
+            payoff->strike(), maturity, process->x0(),
+            process->riskFreeRate()->discount(maturity),
+            process->dividendYield()->discount(maturity),
+            process->blackVolatility()->blackVariance(maturity,
+                                                      payoff->strike())
+        };
+        return std::vector<Real>(signature,
+                                 signature + sizeof(signature)/sizeof(Real));
+    }
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::addSamples(Size samples) const {
+        Size n = workers_.size();
+        if (n == 1) {
+            workers_[0]->addSamples(samples);
+            return;
+        }
+
+        std::vector<Size> shares(n);
+        for (Size i=0; i<n; i++) {
+            if (Randomizations<RNG>::value > 0)
+                // each randomization must draw the same points
+                shares[i] = (samples + n - 1)/n;
+            else
+                shares[i] = samples/n + (i < samples%n ? 1 : 0);
+        }
+
+        // thread i runs workers i, i+threads, i+2*threads...
+        Size threads = std::min(threads_, n);
+        std::vector<std::string> errors(n);
+        boost::thread_group group;
+        for (Size i=1; i<threads; i++)
+            group.create_thread(boost::bind(&runWorkers, &workers_, &shares,
+                                            i, threads, &errors));
+        runWorkers(&workers_, &shares, 0, threads, &errors);
+        group.join_all();
+
+        for (Size i=0; i<n; i++)
+            QL_REQUIRE(errors[i].empty(),
+                       "worker " << i << " failed: " << errors[i]);
+    }
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::runWorkers(
+                  const std::vector<boost::shared_ptr<worker_type> >* workers,
+                  const std::vector<Size>* samples,
+                  Size first, Size stride,
+                  std::vector<std::string>* errors) {
+        for (Size i=first; i<workers->size(); i+=stride) {
+            try {
+                (*workers)[i]->addSamples((*samples)[i]);
+            } catch (std::exception& e) {
+                (*errors)[i] = e.what();
+            } catch (...) {
+                (*errors)[i] = "unknown error";
+            }
+        }
+    }
+
+
+    template <class RNG, class S>
+    inline S MCEuropeanEngine_2<RNG,S>::sampleAccumulator() const {
+        if (workers_.size() == 1)
+            return workers_[0]->sampleAccumulator();
+        // merging in worker order keeps the result reproducible
+        S stats;
+        for (Size i=0; i<workers_.size(); i++)
+            mergeStatistics(stats, workers_[i]->sampleAccumulator());
+        return stats;
+    }
+
+
+    template <class RNG, class S>
+    inline S
+    MCEuropeanEngine_2<RNG,S>::sensitivityAccumulator(Size i) const {
+        if (workers_.size() == 1)
+            return workers_[0]->sensitivityAccumulators()[i];
+        S stats;
+        for (Size j=0; j<workers_.size(); j++)
+            mergeStatistics(stats, workers_[j]->sensitivityAccumulators()[i]);
+        return stats;
+    }
+
+
+    template <class RNG, class S>
+    inline Real
+    MCEuropeanEngine_2<RNG,S>::sensitivityErrorEstimate(Size i) const {
+        if (Randomizations<RNG>::value == 0)
+            return sensitivityAccumulator(i).errorEstimate();
+        // as for the value, only the means over different
+        // randomizations are independent
+        S means;
+        for (Size j=0; j<workers_.size(); j++)
+            means.add(workers_[j]->sensitivityAccumulators()[i].mean());
+        return means.errorEstimate();
+    }
+
+
+    template <class RNG, class S>
+    inline Real MCEuropeanEngine_2<RNG,S>::errorEstimate() const {
+        if (Randomizations<RNG>::value == 0 && momentMatching_) {
+            // moment matching ties together the paths of a batch;
+            // the batches are independent of each other.
+            S batches;
+            for (Size i=0; i<workers_.size(); i++) {
+                boost::shared_ptr<batch_worker_type> worker =
+                    boost::dynamic_pointer_cast<batch_worker_type>(
+                                                               workers_[i]);
+                QL_REQUIRE(worker, "moment matching not used");
+                mergeStatistics(batches, worker->batchAccumulator());
+            }
+            // too few batches for their spread to mean anything; the
+            // path-wise estimate is an upper bound.
+            if (batches.samples() > 1)
+                return batches.errorEstimate();
+        }
+        if (Randomizations<RNG>::value == 0)
+            return sampleAccumulator().errorEstimate();
+        // the points drawn with one randomization are not independent;
+        // the means over different randomizations are.
+        S means;
+        for (Size i=0; i<workers_.size(); i++)
+            means.add(workers_[i]->sampleAccumulator().mean());
+        return means.errorEstimate();
+    }
+
+
+    template <class RNG, class S>
+    inline S MCEuropeanEngine_2<RNG,S>::uncontrolledAccumulator() const {
+        S stats;
+        for (Size i=0; i<workers_.size(); i++) {
+            boost::shared_ptr<control_worker_type> worker =
+                boost::dynamic_pointer_cast<control_worker_type>(workers_[i]);
+            QL_REQUIRE(worker, "control variate not used");
+            mergeStatistics(stats, worker->uncontrolledAccumulator());
+        }
+        return stats;
+    }
+
+
+    template <class RNG, class S>
+    inline Real MCEuropeanEngine_2<RNG,S>::controlVariateValue() const {
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                this->arguments_.payoff);
+        QL_REQUIRE(payoff, "non-plain payoff given");
+
+        const boost::shared_ptr<GeneralizedBlackScholesProcess>& process =
+            blackScholesProcess_;
+
+        // expectation of the control path price, on the sampling grid
+        boost::shared_ptr<constantBlackScholesProcess> control =
+            constantProcess();
+        Time t = this->timeGrid().back();
+        Real forward = control->x0()*std::exp(control->riskDrift()*t);
+        Real stdDev = control->volatility()*std::sqrt(t);
+        return blackFormula(payoff->optionType(), payoff->strike(), forward,
+                            stdDev, process->riskFreeRate()->discount(t));
+    }
+
+
+    template <class RNG, class S>
+    inline boost::shared_ptr<EuropeanGreeksPathPricer_2>
+    MCEuropeanEngine_2<RNG,S>::greeksPathPricer() const {
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                this->arguments_.payoff);
+        QL_REQUIRE(payoff, "non-plain payoff given");
+
+        const boost::shared_ptr<GeneralizedBlackScholesProcess>& process =
+            blackScholesProcess_;
+
+        boost::shared_ptr<constantBlackScholesProcess> constant =
+            constantProcess();
+        Time maturity = this->timeGrid().back();
+        // the rate implied by the discount used by the path pricer,
+        // so that the price is differentiated as it is computed
+        Rate riskFreeRate =
+            -std::log(process->riskFreeRate()->discount(maturity))/maturity;
+        Rate dividendYield = riskFreeRate - constant->riskDrift();
+
+        return boost::shared_ptr<EuropeanGreeksPathPricer_2>(
+            new EuropeanGreeksPathPricer_2(payoff->optionType(),
+                                           payoff->strike(),
+                                           constant->x0(),
+                                           riskFreeRate,
+                                           dividendYield,
+                                           constant->volatility(),
+                                           maturity));
     }
 
 
@@ -185,23 +1061,56 @@ namespace QuantLib {
     inline
     boost::shared_ptr<typename MCEuropeanEngine_2<RNG,S>::path_pricer_type>
     MCEuropeanEngine_2<RNG,S>::pathPricer() const {
+        return europeanPathPricer();
+    }
+
+
+    template <class RNG, class S>
+    inline boost::shared_ptr<EuropeanPathPricer_2>
+    MCEuropeanEngine_2<RNG,S>::europeanPathPricer(Real shift) const {
 
         boost::shared_ptr<PlainVanillaPayoff> payoff =
             boost::dynamic_pointer_cast<PlainVanillaPayoff>(
                 this->arguments_.payoff);
         QL_REQUIRE(payoff, "non-plain payoff given");
 
-        boost::shared_ptr<GeneralizedBlackScholesProcess> process =
-            boost::dynamic_pointer_cast<GeneralizedBlackScholesProcess>(
-                this->process_);
-        QL_REQUIRE(process, "Black-Scholes process required");
+        const boost::shared_ptr<GeneralizedBlackScholesProcess>& process =
+            blackScholesProcess_;
+
+        Time maturity = this->timeGrid().back();
+        DiscountFactor discount = process->riskFreeRate()->discount(maturity);
+        if (shift == 0.0)
+            return boost::shared_ptr<EuropeanPathPricer_2>(
+                new EuropeanPathPricer_2(payoff->optionType(),
+                                         payoff->strike(), discount));
 
-        return boost::shared_ptr<
-                       typename MCEuropeanEngine_2<RNG,S>::path_pricer_type>(
-          new EuropeanPathPricer_2(
-              payoff->optionType(),
-              payoff->strike(),
-              process->riskFreeRate()->discount(this->timeGrid().back())));
+        boost::shared_ptr<constantBlackScholesProcess> constant =
+            constantProcess();
+        Volatility sigma = constant->volatility();
+        return boost::shared_ptr<EuropeanPathPricer_2>(
+            new EuropeanPathPricer_2(
+                payoff->optionType(), payoff->strike(), discount,
+                constant->x0(),
+                (constant->riskDrift() - 0.5*sigma*sigma)*maturity,
+                sigma*std::sqrt(maturity), shift));
+    }
+
+
+    template <class RNG, class S>
+    inline Real MCEuropeanEngine_2<RNG,S>::importanceSamplingShift() const {
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                this->arguments_.payoff);
+        QL_REQUIRE(payoff, "non-plain payoff given");
+
+        boost::shared_ptr<constantBlackScholesProcess> constant =
+            constantProcess();
+        Time maturity = this->timeGrid().back();
+        Volatility sigma = constant->volatility();
+        return europeanDriftShift(
+                       payoff->optionType(), payoff->strike(), constant->x0(),
+                       (constant->riskDrift() - 0.5*sigma*sigma)*maturity,
+                       sigma*std::sqrt(maturity));
     }
 
 
@@ -211,7 +1120,12 @@ namespace QuantLib {
     : process_(process), antithetic_(false),
       steps_(Null<Size>()), stepsPerYear_(Null<Size>()),
       samples_(Null<Size>()), maxSamples_(Null<Size>()),
-      tolerance_(Null<Real>()), brownianBridge_(false), seed_(0){}
+      tolerance_(Null<Real>()), timeBudget_(Null<Real>()),
+      brownianBridge_(false),
+      controlVariate_(false), greeks_(false), momentMatching_(false),
+      importanceSampling_(false), seed_(0),
+      constant_(false), threads_(1), batchSize_(Null<Size>()),
+      checkpointInterval_(Null<Size>()) {}
 
     template <class RNG, class S>
     inline MakeMCEuropeanEngine_2<RNG,S>&
@@ -226,6 +1140,20 @@ namespace QuantLib {
         constant_ = constant;
         return *this;
     }
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withThreads(Size threads) {
+        threads_ = threads;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withBatchSize(Size batchSize) {
+        batchSize_ = batchSize;
+        return *this;
+    }
+
     template <class RNG, class S>
     inline MakeMCEuropeanEngine_2<RNG,S>&
     MakeMCEuropeanEngine_2<RNG,S>::withStepsPerYear(Size steps) {
@@ -282,6 +1210,50 @@ namespace QuantLib {
         return *this;
     }
 
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withControlVariate(bool b) {
+        controlVariate_ = b;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withGreeks(bool b) {
+        greeks_ = b;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withTimeBudget(Real milliseconds) {
+        timeBudget_ = milliseconds;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withMomentMatching(bool b) {
+        momentMatching_ = b;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withImportanceSampling(bool b) {
+        importanceSampling_ = b;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withCheckpoint(const std::string& fileName,
+                                                  Size interval) {
+        checkpointFile_ = fileName;
+        checkpointInterval_ = interval;
+        return *this;
+    }
+
     template <class RNG, class S>
     inline
     MakeMCEuropeanEngine_2<RNG,S>::operator boost::shared_ptr<PricingEngine>()
@@ -298,7 +1270,13 @@ namespace QuantLib {
                                       antithetic_,
                                       samples_, tolerance_,
                                       maxSamples_,
-                                      seed_, constant_));
+                                      seed_, constant_,
+                                      threads_, batchSize_,
+                                      controlVariate_, greeks_,
+                                      timeBudget_, momentMatching_,
+                                      importanceSampling_,
+                                      checkpointFile_,
+                                      checkpointInterval_));
     }
 
 
@@ -306,14 +1284,134 @@ namespace QuantLib {
     inline EuropeanPathPricer_2::EuropeanPathPricer_2(Option::Type type,
                                                       Real strike,
                                                       DiscountFactor discount)
+    : payoff_(type, strike), discount_(discount),
+      logScale_(0.0), exponent_(0.0) {
+        QL_REQUIRE(strike>=0.0,
+                   "strike less than zero not allowed");
+    }
+
+    inline EuropeanPathPricer_2::EuropeanPathPricer_2(Option::Type type,
+                                                      Real strike,
+                                                      DiscountFactor discount,
+                                                      Real x0,
+                                                      Real logDrift,
+                                                      Real logStdDev,
+                                                      Real shift)
     : payoff_(type, strike), discount_(discount) {
         QL_REQUIRE(strike>=0.0,
                    "strike less than zero not allowed");
+        QL_REQUIRE(logStdDev > 0.0, "null variance not allowed");
+        // -shift*Y + shift^2/2, with Y = (log(S_T/x0) - logDrift)/logStdDev
+        exponent_ = shift/logStdDev;
+        logScale_ = 0.5*shift*shift + exponent_*(std::log(x0) + logDrift);
     }
 
     inline Real EuropeanPathPricer_2::operator()(const Path& path) const {
         QL_REQUIRE(path.length() > 0, "the path cannot be empty");
-        return payoff_(path.back()) * discount_;
+        Real price = payoff_(path.back()) * discount_;
+        if (exponent_ != 0.0 && price != 0.0)
+            price *= std::exp(logScale_ - exponent_*std::log(path.back()));
+        return price;
+    }
+
+    inline EuropeanGreeksPathPricer_2::EuropeanGreeksPathPricer_2(
+                                                    Option::Type type,
+                                                    Real strike,
+                                                    Real x0,
+                                                    Rate riskFreeRate,
+                                                    Rate dividendYield,
+                                                    Volatility volatility,
+                                                    Time maturity)
+    : omega_(type == Option::Call ? 1.0 : -1.0), strike_(strike), x0_(x0),
+      riskFreeRate_(riskFreeRate), dividendYield_(dividendYield),
+      volatility_(volatility), maturity_(maturity),
+      discount_(std::exp(-riskFreeRate*maturity)),
+      stdDev_(volatility*std::sqrt(maturity)) {
+        QL_REQUIRE(strike>=0.0,
+                   "strike less than zero not allowed");
+        QL_REQUIRE(stdDev_ > 0.0, "null variance not allowed");
+    }
+
+    inline void EuropeanGreeksPathPricer_2::operator()(const Path& path,
+                                                       Real* greeks) const {
+        QL_REQUIRE(path.length() > 0, "the path cannot be empty");
+        // forward pass
+        Real s = path.back();
+        Real x = std::log(s/x0_);
+        Real payoff = omega_*(s-strike_);
+        if (payoff <= 0.0) {
+            std::fill(greeks, greeks+Greeks, 0.0);
+            return;
+        }
+        Real sigma = volatility_, t = maturity_;
+        Real z = (x - (riskFreeRate_ - dividendYield_ - 0.5*sigma*sigma)*t)
+                 / stdDev_;
+
+        // reverse pass, starting from the adjoint of the price
+        Real sBar = discount_*omega_;
+        Real discountBar = payoff;
+        Real xBar = sBar*s;
+        greeks[Delta] = sBar*s/x0_;
+        greeks[Vega] = xBar*(std::sqrt(t)*z - sigma*t);
+        greeks[Rho] = xBar*t - discountBar*discount_*t;
+        greeks[DividendRho] = -xBar*t;
+        greeks[Gamma] = greeks[Delta]/x0_*(z/stdDev_ - 1.0);
+    }
+
+    inline void EuropeanPathPricer_2::operator()(const Real* terminalValues,
+                                                 Size n,
+                                                 Real* prices) const {
+        Real omega = (payoff_.optionType() == Option::Call ? 1.0 : -1.0);
+        vanillaPayoff(terminalValues, n, omega, payoff_.strike(), discount_,
+                      prices);
+        if (exponent_ != 0.0)
+            importanceWeights(terminalValues, n, logScale_, exponent_,
+                              prices);
+    }
+
+
+    namespace detail {
+
+        // zero at the stationary point of log f(z) - z^2/2, multiplied
+        // by the payoff so that it stays finite at the strike
+        class EuropeanDriftShiftTarget_2 {
+          public:
+            EuropeanDriftShiftTarget_2(Real omega, Real strike, Real x0,
+                                       Real logDrift, Real logStdDev)
+            : omega_(omega), strike_(strike), x0_(x0),
+              logDrift_(logDrift), logStdDev_(logStdDev) {}
+            Real operator()(Real z) const {
+                Real s = x0_*std::exp(logDrift_ + logStdDev_*z);
+                return omega_*logStdDev_*s - z*omega_*(s - strike_);
+            }
+          private:
+            Real omega_, strike_, x0_, logDrift_, logStdDev_;
+        };
+
+    }
+
+    inline Real europeanDriftShift(Option::Type type,
+                                   Real strike,
+                                   Real x0,
+                                   Real logDrift,
+                                   Real logStdDev) {
+        QL_REQUIRE(strike > 0.0, "positive strike required");
+        QL_REQUIRE(logStdDev > 0.0, "null variance not allowed");
+        Real omega = (type == Option::Call ? 1.0 : -1.0);
+        // the payoff is positive beyond the strike point
+        Real strikePoint = (std::log(strike/x0) - logDrift)/logStdDev;
+        // the target has the sign of omega at the strike point and the
+        // opposite one far enough into the exercise region
+        Real far = strikePoint + omega*(std::fabs(strikePoint) +
+                                        logStdDev + 10.0);
+        detail::EuropeanDriftShiftTarget_2 target(omega, strike, x0,
+                                                  logDrift, logStdDev);
+        Brent solver;
+        solver.setMaxEvaluations(1000);
+        return solver.solve(target, 1.0e-8,
+                            strikePoint + omega*1.0e-4,
+                            std::min(strikePoint, far),
+                            std::max(strikePoint, far));
     }
 
 }
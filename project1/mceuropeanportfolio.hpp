@@ -0,0 +1,254 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file mceuropeanportfolio.hpp
+    \brief Monte Carlo pricing of a portfolio of European options
+*/
+
+#ifndef montecarlo_european_portfolio_hpp
+#define montecarlo_european_portfolio_hpp
+
+#include "mceuropeanengine.hpp"
+#include <ql/patterns/lazyobject.hpp>
+#include <ql/math/statistics/incrementalstatistics.hpp>
+#include <map>
+#include <set>
+
+namespace QuantLib {
+
+    //! Monte Carlo pricer for European options on the same underlying
+    /*! Options are grouped by maturity; for each maturity, a single
+        set of paths is simulated and all the payoffs are evaluated on
+        its terminal values, batchSize paths at a time, by the batch
+        operator of EuropeanPathPricer_2.  The cost of the simulation
+        therefore grows with the number of distinct maturities, while
+        each additional option only adds a vectorized payoff loop.
+
+        Paths are generated as by MCEuropeanEngine_2 on the generic
+        process route, since with a volatility smile the frozen
+        coefficients of constantBlackScholesProcess would depend on
+        the strike.  Each option keeps its own accumulator; the
+        default one stores running sums only, so that the memory used
+        does not grow with the number of samples.
+    */
+    template <class RNG = PseudoRandom, class S = IncrementalStatistics>
+    class MCEuropeanPortfolio_2 : public LazyObject {
+      public:
+        MCEuropeanPortfolio_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size timeSteps,
+             Size timeStepsPerYear,
+             bool brownianBridge,
+             bool antitheticVariate,
+             Size requiredSamples,
+             BigNatural seed,
+             Size batchSize = 1024);
+        //! adds an option and returns its index in the portfolio
+        Size add(const boost::shared_ptr<StrikedTypePayoff>& payoff,
+                 const boost::shared_ptr<Exercise>& exercise);
+        //! \name Inspectors
+        //@{
+        Size size() const { return payoffs_.size(); }
+        //! number of distinct maturities, i.e., of path sets simulated
+        Size maturities() const;
+        //@}
+        //! \name Results
+        //@{
+        Real NPV(Size i) const;
+        Real errorEstimate(Size i) const;
+        const S& sampleAccumulator(Size i) const;
+        //@}
+      protected:
+        void performCalculations() const;
+      private:
+        typedef typename AllocationFreeRsg<RNG>::type sequence_generator_type;
+        typedef PathGenerator_2<sequence_generator_type> path_generator_type;
+        TimeGrid timeGrid(Time maturity) const;
+        void simulate(const Date& maturity,
+                      const std::vector<Size>& options) const;
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
+        Size timeSteps_, timeStepsPerYear_;
+        bool brownianBridge_, antitheticVariate_;
+        Size requiredSamples_;
+        BigNatural seed_;
+        Size batchSize_;
+        std::vector<boost::shared_ptr<StrikedTypePayoff> > payoffs_;
+        std::vector<Date> maturities_;
+        mutable std::vector<S> stats_;
+    };
+
+
+    // inline definitions
+
+    template <class RNG, class S>
+    inline MCEuropeanPortfolio_2<RNG,S>::MCEuropeanPortfolio_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size timeSteps,
+             Size timeStepsPerYear,
+             bool brownianBridge,
+             bool antitheticVariate,
+             Size requiredSamples,
+             BigNatural seed,
+             Size batchSize)
+    : process_(process), timeSteps_(timeSteps),
+      timeStepsPerYear_(timeStepsPerYear), brownianBridge_(brownianBridge),
+      antitheticVariate_(antitheticVariate),
+      requiredSamples_(requiredSamples), seed_(seed),
+      batchSize_(batchSize) {
+        QL_REQUIRE(timeSteps != Null<Size>() ||
+                   timeStepsPerYear != Null<Size>(),
+                   "no time steps provided");
+        QL_REQUIRE(timeSteps == Null<Size>() ||
+                   timeStepsPerYear == Null<Size>(),
+                   "both time steps and time steps per year were provided");
+        QL_REQUIRE(timeSteps != 0,
+                   "timeSteps must be positive, " << timeSteps <<
+                   " not allowed");
+        QL_REQUIRE(timeStepsPerYear != 0,
+                   "timeStepsPerYear must be positive, "
+                   << timeStepsPerYear << " not allowed");
+        QL_REQUIRE(requiredSamples != Null<Size>() && requiredSamples > 0,
+                   "number of samples not given");
+        QL_REQUIRE(batchSize > 0, "null batch size");
+        QL_REQUIRE(Randomizations<RNG>::value == 0,
+                   "randomized quasi-Monte Carlo not supported");
+        registerWith(process_);
+    }
+
+    template <class RNG, class S>
+    inline Size MCEuropeanPortfolio_2<RNG,S>::add(
+                          const boost::shared_ptr<StrikedTypePayoff>& payoff,
+                          const boost::shared_ptr<Exercise>& exercise) {
+        QL_REQUIRE(boost::dynamic_pointer_cast<PlainVanillaPayoff>(payoff),
+                   "non-plain payoff given");
+        QL_REQUIRE(exercise->type() == Exercise::European,
+                   "not an European option");
+        payoffs_.push_back(payoff);
+        maturities_.push_back(exercise->lastDate());
+        update();
+        return payoffs_.size()-1;
+    }
+
+    template <class RNG, class S>
+    inline Size MCEuropeanPortfolio_2<RNG,S>::maturities() const {
+        std::set<Date> dates(maturities_.begin(), maturities_.end());
+        return dates.size();
+    }
+
+    template <class RNG, class S>
+    inline Real MCEuropeanPortfolio_2<RNG,S>::NPV(Size i) const {
+        return sampleAccumulator(i).mean();
+    }
+
+    template <class RNG, class S>
+    inline Real MCEuropeanPortfolio_2<RNG,S>::errorEstimate(Size i) const {
+        QL_REQUIRE(RNG::allowsErrorEstimate,
+                   "chosen random generator policy "
+                   "does not allow an error estimate");
+        return sampleAccumulator(i).errorEstimate();
+    }
+
+    template <class RNG, class S>
+    inline const S&
+    MCEuropeanPortfolio_2<RNG,S>::sampleAccumulator(Size i) const {
+        QL_REQUIRE(i < payoffs_.size(),
+                   "option " << i << " not in portfolio");
+        calculate();
+        return stats_[i];
+    }
+
+    template <class RNG, class S>
+    inline void MCEuropeanPortfolio_2<RNG,S>::performCalculations() const {
+        std::map<Date, std::vector<Size> > groups;
+        for (Size i=0; i<maturities_.size(); i++)
+            groups[maturities_[i]].push_back(i);
+
+        stats_ = std::vector<S>(payoffs_.size());
+        for (typename std::map<Date, std::vector<Size> >::const_iterator
+                 g = groups.begin(); g != groups.end(); ++g)
+            simulate(g->first, g->second);
+    }
+
+    template <class RNG, class S>
+    inline TimeGrid MCEuropeanPortfolio_2<RNG,S>::timeGrid(
+                                                       Time maturity) const {
+        // same as MCVanillaEngine::timeGrid()
+        if (timeSteps_ != Null<Size>()) {
+            return TimeGrid(maturity, timeSteps_);
+        } else {
+            Size steps = static_cast<Size>(timeStepsPerYear_*maturity);
+            return TimeGrid(maturity, std::max<Size>(steps, 1));
+        }
+    }
+
+    template <class RNG, class S>
+    inline void MCEuropeanPortfolio_2<RNG,S>::simulate(
+                                    const Date& maturity,
+                                    const std::vector<Size>& options) const {
+        Time t = process_->time(maturity);
+        TimeGrid grid = timeGrid(t);
+        DiscountFactor discount = process_->riskFreeRate()->discount(t);
+
+        std::vector<EuropeanPathPricer_2> pricers;
+        for (Size k=0; k<options.size(); k++) {
+            const boost::shared_ptr<StrikedTypePayoff>& payoff =
+                payoffs_[options[k]];
+            pricers.push_back(EuropeanPathPricer_2(payoff->optionType(),
+                                                   payoff->strike(),
+                                                   discount));
+        }
+
+        path_generator_type generator(
+            process_, grid,
+            AllocationFreeRsg<RNG>::make(grid.size()-1, seed_),
+            brownianBridge_);
+
+        std::vector<Real> terminal(batchSize_), antithetic(batchSize_),
+                          weights(batchSize_), prices(batchSize_),
+                          antitheticPrices(batchSize_);
+        Size samples = requiredSamples_;
+        while (samples > 0) {
+            Size n = std::min(samples, batchSize_);
+            for (Size j=0; j<n; j++) {
+                const typename path_generator_type::sample_type& path =
+                    generator.next();
+                terminal[j] = path.value.back();
+                weights[j] = path.weight;
+                if (antitheticVariate_)
+                    antithetic[j] = generator.antithetic().value.back();
+            }
+            for (Size k=0; k<options.size(); k++) {
+                S& stats = stats_[options[k]];
+                pricers[k](&terminal[0], n, &prices[0]);
+                if (antitheticVariate_) {
+                    pricers[k](&antithetic[0], n, &antitheticPrices[0]);
+                    for (Size j=0; j<n; j++)
+                        stats.add((prices[j]+antitheticPrices[j])/2.0,
+                                  weights[j]);
+                } else {
+                    for (Size j=0; j<n; j++)
+                        stats.add(prices[j], weights[j]);
+                }
+            }
+            samples -= n;
+        }
+    }
+
+}
+
+
+#endif
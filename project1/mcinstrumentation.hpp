@@ -0,0 +1,125 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file mcinstrumentation.hpp
+    \brief Opt-in per-phase counters for the Monte Carlo engines
+
+    The counters are compiled in only when MC_ENABLE_INSTRUMENTATION
+    is defined; otherwise MC_PHASE_TIMER expands to nothing and the
+    classes using it carry no counters at all.
+*/
+
+#ifndef mc_instrumentation_hpp
+#define mc_instrumentation_hpp
+
+#include <ql/types.hpp>
+#include <boost/chrono.hpp>
+#include <boost/cstdint.hpp>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace QuantLib {
+
+    //! phases of the sampling of a Monte Carlo engine
+    enum McPhase {
+        McSetup,         //!< construction of generators and pricers
+        McRng,           //!< random draws and Brownian-bridge transform
+        McEvolution,     //!< path evolution
+        McPayoff,        //!< path pricing
+        McAccumulation,  //!< statistics accumulation
+        McPhases
+    };
+
+    //! name of the phase, as used in the additional results
+    inline const char* mcPhaseName(McPhase phase) {
+        static const char* names[] = {
+            "setup", "rng", "evolution", "payoff", "accumulation"
+        };
+        return names[phase];
+    }
+
+    //! elapsed ticks and number of items for each phase
+    /*! Ticks are read from the time-stamp counter on x86, hence
+        they are CPU cycles; elsewhere they are nanoseconds of a
+        steady clock.  Items are paths for the sampling phases and
+        generator/pricer pairs for the setup.
+    */
+    class McCounters_2 {
+      public:
+        McCounters_2() { reset(); }
+        void reset() {
+            for (Size i=0; i<McPhases; i++)
+                ticks_[i] = counts_[i] = 0;
+        }
+        void add(McPhase phase, boost::uint64_t ticks, Size count) {
+            ticks_[phase] += ticks;
+            counts_[phase] += count;
+        }
+        McCounters_2& operator+=(const McCounters_2& other) {
+            for (Size i=0; i<McPhases; i++) {
+                ticks_[i] += other.ticks_[i];
+                counts_[i] += other.counts_[i];
+            }
+            return *this;
+        }
+        boost::uint64_t ticks(McPhase phase) const { return ticks_[phase]; }
+        Size count(McPhase phase) const { return counts_[phase]; }
+        static boost::uint64_t now() {
+            #if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+            #else
+            return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+                boost::chrono::steady_clock::now().time_since_epoch())
+                .count();
+            #endif
+        }
+      private:
+        boost::uint64_t ticks_[McPhases];
+        Size counts_[McPhases];
+    };
+
+
+    //! adds the ticks elapsed during its lifetime to a phase
+    class McPhaseTimer_2 {
+      public:
+        McPhaseTimer_2(McCounters_2& counters, McPhase phase, Size count)
+        : counters_(counters), phase_(phase), count_(count),
+          start_(McCounters_2::now()) {}
+        ~McPhaseTimer_2() {
+            counters_.add(phase_, McCounters_2::now() - start_, count_);
+        }
+      private:
+        McCounters_2& counters_;
+        McPhase phase_;
+        Size count_;
+        boost::uint64_t start_;
+    };
+
+}
+
+
+#ifdef MC_ENABLE_INSTRUMENTATION
+#define MC_PHASE_TIMER(counters, phase, count) \
+    QuantLib::McPhaseTimer_2 mc_phase_timer_##phase((counters), \
+                                                    QuantLib::phase, (count))
+#else
+#define MC_PHASE_TIMER(counters, phase, count)
+#endif
+
+
+#endif
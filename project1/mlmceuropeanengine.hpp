@@ -0,0 +1,341 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file mlmceuropeanengine.hpp
+    \brief Multilevel Monte Carlo European option engine
+*/
+
+#ifndef multilevel_montecarlo_european_engine_hpp
+#define multilevel_montecarlo_european_engine_hpp
+
+#include "mceuropeanengine.hpp"
+
+namespace QuantLib {
+
+    //! European option pricing engine using multilevel Monte Carlo
+    /*! Level \f$ l \f$ samples paths on a grid with \f$ n 2^l \f$
+        steps, \f$ n \f$ being the number of steps of the coarsest
+        one.  Level 0 estimates the price on the coarsest grid; every
+        other level estimates the difference between the prices on
+        its grid and on the previous one, both paths being driven by
+        the same Brownian increments (the coarse increment is the sum
+        of two fine ones) so that the difference has a small
+        variance.
+
+        Samples are allocated across levels as in Giles (2008), so
+        that the variance of the estimator is half the square of the
+        required tolerance at the smallest cost; levels are added
+        until the estimated discretization bias accounts for at most
+        the other half.  With constant parameters the exact
+        log-normal step leaves no bias and a single set of coarse
+        samples is usually enough.
+
+        The number of levels and the samples drawn on each of them
+        are returned as the "levels" and "samplesPerLevel" additional
+        results.
+
+        \ingroup vanillaengines
+    */
+    template <class RNG = PseudoRandom, class S = Statistics>
+    class MLMCEuropeanEngine_2 : public MCEuropeanEngine_2<RNG,S> {
+      public:
+        MLMCEuropeanEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size timeSteps,
+             Real requiredTolerance,
+             BigNatural seed,
+             bool constant,
+             Size maxLevels = 10,
+             Size initialSamples = 1000);
+        void calculate() const;
+      private:
+        class Level;
+        Size timeSteps_, maxLevels_, initialSamples_;
+        bool constant_;
+    };
+
+
+    //! Multilevel Monte Carlo European engine factory
+    template <class RNG = PseudoRandom, class S = Statistics>
+    class MakeMLMCEuropeanEngine_2 {
+      public:
+        MakeMLMCEuropeanEngine_2(
+                    const boost::shared_ptr<GeneralizedBlackScholesProcess>&);
+        // named parameters
+        MakeMLMCEuropeanEngine_2& withSteps(Size steps);
+        MakeMLMCEuropeanEngine_2& withAbsoluteTolerance(Real tolerance);
+        MakeMLMCEuropeanEngine_2& withSeed(BigNatural seed);
+        MakeMLMCEuropeanEngine_2& withconstParameter(bool constant);
+        MakeMLMCEuropeanEngine_2& withMaxLevels(Size levels);
+        MakeMLMCEuropeanEngine_2& withInitialSamples(Size samples);
+        // conversion to pricing engine
+        operator boost::shared_ptr<PricingEngine>() const;
+      private:
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
+        Size steps_;
+        Real tolerance_;
+        BigNatural seed_;
+        bool constant_;
+        Size maxLevels_, initialSamples_;
+    };
+
+
+    //! samples of one level of the multilevel estimator
+    template <class RNG, class S>
+    class MLMCEuropeanEngine_2<RNG,S>::Level {
+      public:
+        Level(const boost::shared_ptr<StochasticProcess1D>& process,
+              const boost::shared_ptr<EuropeanPathPricer_2>& pricer,
+              Time maturity,
+              Size steps,
+              bool coupled,
+              BigNatural seed)
+        : process_(process), pricer_(pricer), grid_(maturity, steps),
+          coupled_(coupled),
+          generator_(AllocationFreeRsg<RNG>::make(steps, seed)) {}
+        //! adds the given number of samples
+        void addSamples(Size samples);
+        const S& statistics() const { return statistics_; }
+        //! relative cost of a sample, i.e., number of steps evolved
+        Real cost() const {
+            return coupled_ ? 1.5*(grid_.size()-1) : grid_.size()-1;
+        }
+      private:
+        boost::shared_ptr<StochasticProcess1D> process_;
+        boost::shared_ptr<EuropeanPathPricer_2> pricer_;
+        TimeGrid grid_;
+        bool coupled_;
+        typename AllocationFreeRsg<RNG>::type generator_;
+        S statistics_;
+    };
+
+
+    // inline definitions
+
+    template <class RNG, class S>
+    inline MLMCEuropeanEngine_2<RNG,S>::MLMCEuropeanEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size timeSteps,
+             Real requiredTolerance,
+             BigNatural seed,
+             bool constant,
+             Size maxLevels,
+             Size initialSamples)
+    : MCEuropeanEngine_2<RNG,S>(process, timeSteps, Null<Size>(),
+                                false, false, Null<Size>(),
+                                requiredTolerance, Null<Size>(),
+                                seed, constant),
+      timeSteps_(timeSteps), maxLevels_(maxLevels),
+      initialSamples_(initialSamples), constant_(constant) {
+        QL_REQUIRE(RNG::allowsErrorEstimate &&
+                   Randomizations<RNG>::value == 0,
+                   "multilevel Monte Carlo needs independent samples");
+        QL_REQUIRE(requiredTolerance != Null<Real>() &&
+                   requiredTolerance > 0.0,
+                   "tolerance not given");
+        // the bias is estimated from the last two corrections
+        QL_REQUIRE(maxLevels >= 3, "at least three levels required");
+        QL_REQUIRE(initialSamples > 1,
+                   "at least two initial samples required");
+    }
+
+
+    template <class RNG, class S>
+    inline void MLMCEuropeanEngine_2<RNG,S>::calculate() const {
+        boost::shared_ptr<StochasticProcess1D> process;
+        if (constant_)
+            process = this->constantProcess();
+        else
+            process = this->blackScholesProcess_;
+        boost::shared_ptr<EuropeanPathPricer_2> pricer =
+            this->europeanPathPricer();
+        Time maturity = this->timeGrid().back();
+        Real tolerance = this->requiredTolerance_;
+
+        // levels are independent, hence one seed each
+        MersenneTwisterUniformRng seeder(this->seed_);
+        std::vector<boost::shared_ptr<Level> > levels;
+        std::vector<Size> samples, extraSamples;
+
+        // Giles' algorithm: start with three levels, allocate samples
+        // according to the estimated variances and costs, and add
+        // levels until the estimated bias is small enough.
+        Size size = 3;
+        for (;;) {
+            while (levels.size() < size) {
+                Size l = levels.size();
+                BigNatural seed;
+                do {
+                    seed = seeder.nextInt32();
+                } while (seed == 0); // 0 would mean a random seed
+                levels.push_back(boost::shared_ptr<Level>(
+                    new Level(process, pricer, maturity,
+                              timeSteps_ << l, l > 0, seed)));
+                samples.push_back(0);
+                extraSamples.push_back(initialSamples_);
+            }
+
+            for (Size l=0; l<levels.size(); l++) {
+                levels[l]->addSamples(extraSamples[l]);
+                samples[l] += extraSamples[l];
+            }
+
+            // optimal allocation for a variance of tolerance^2/2
+            Real sum = 0.0;
+            for (Size l=0; l<levels.size(); l++)
+                sum += std::sqrt(levels[l]->statistics().variance()
+                                 * levels[l]->cost());
+            bool allocated = true;
+            for (Size l=0; l<levels.size(); l++) {
+                Real optimal =
+                    std::ceil(2.0 * std::sqrt(levels[l]->statistics().variance()
+                                              / levels[l]->cost())
+                              * sum / (tolerance*tolerance));
+                extraSamples[l] = (optimal > samples[l] ?
+                                   Size(optimal) - samples[l] : 0);
+                // less than 1% more is not worth another pass
+                if (extraSamples[l] > 0.01*samples[l])
+                    allocated = false;
+            }
+            if (!allocated)
+                continue;
+
+            // weak order one: the remaining bias is about the last
+            // correction; the previous one is also used, scaled,
+            // since a single mean can be small by chance.
+            Size L = levels.size()-1;
+            Real bias = std::max(
+                std::fabs(levels[L]->statistics().mean()),
+                0.5*std::fabs(levels[L-1]->statistics().mean()));
+            if (bias <= tolerance/M_SQRT2)
+                break;
+            QL_REQUIRE(levels.size() < maxLevels_,
+                       "max number of levels (" << maxLevels_
+                       << ") reached, while estimated bias (" << bias
+                       << ") is still above tolerance ("
+                       << tolerance/M_SQRT2 << ")");
+            size = levels.size()+1;
+            std::fill(extraSamples.begin(), extraSamples.end(), 0);
+        }
+
+        Real value = 0.0, variance = 0.0;
+        Size total = 0;
+        for (Size l=0; l<levels.size(); l++) {
+            const S& stats = levels[l]->statistics();
+            value += stats.mean();
+            variance += stats.variance()/stats.samples();
+            total += samples[l];
+        }
+        this->results_.value = value;
+        this->results_.errorEstimate = std::sqrt(variance);
+        this->results_.additionalResults["samples"] = total;
+        this->results_.additionalResults["levels"] = levels.size();
+        this->results_.additionalResults["samplesPerLevel"] = samples;
+    }
+
+
+    template <class RNG, class S>
+    inline void MLMCEuropeanEngine_2<RNG,S>::Level::addSamples(Size samples) {
+        typedef typename AllocationFreeRsg<RNG>::type::sample_type
+            sequence_type;
+        reserveSamples(statistics_, statistics_.samples() + samples);
+        Size steps = grid_.size()-1;
+        Real x0 = process_->x0();
+        for (Size j=0; j<samples; j++) {
+            const sequence_type& sequence = generator_.nextSequence();
+            const std::vector<Real>& dw = sequence.value;
+            Real x[2] = { x0, x0 };
+            for (Size i=0; i<steps; i++) {
+                x[0] = process_->evolve(grid_[i], x[0], grid_.dt(i), dw[i]);
+                if (coupled_ && i%2 == 1) {
+                    // coarse step over the last two fine ones
+                    x[1] = process_->evolve(grid_[i-1], x[1],
+                                            grid_[i+1]-grid_[i-1],
+                                            (dw[i-1]+dw[i])/M_SQRT2);
+                }
+            }
+            Real prices[2];
+            (*pricer_)(x, coupled_ ? 2 : 1, prices);
+            statistics_.add(coupled_ ? prices[0]-prices[1] : prices[0],
+                            sequence.weight);
+        }
+    }
+
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>::MakeMLMCEuropeanEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process)
+    : process_(process), steps_(Null<Size>()), tolerance_(Null<Real>()),
+      seed_(0), constant_(false), maxLevels_(10), initialSamples_(1000) {}
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withSteps(Size steps) {
+        steps_ = steps;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withAbsoluteTolerance(Real tolerance) {
+        tolerance_ = tolerance;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withSeed(BigNatural seed) {
+        seed_ = seed;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withconstParameter(bool constant) {
+        constant_ = constant;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withMaxLevels(Size levels) {
+        maxLevels_ = levels;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withInitialSamples(Size samples) {
+        initialSamples_ = samples;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline
+    MakeMLMCEuropeanEngine_2<RNG,S>::operator boost::shared_ptr<PricingEngine>()
+                                                                      const {
+        QL_REQUIRE(steps_ != Null<Size>(), "number of steps not given");
+        return boost::shared_ptr<PricingEngine>(new
+            MLMCEuropeanEngine_2<RNG,S>(process_, steps_, tolerance_, seed_,
+                                        constant_, maxLevels_,
+                                        initialSamples_));
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,112 @@
+#include "constantBlackScholesProcess.hpp"
+#include "mceuropeanengine.hpp"
+#include <ql/quantlib.hpp>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace QuantLib;
+
+// Compares moment matching with antithetic variates alone on the put
+// priced in main.cpp.
+//
+// usage: momentmatchingcheck [seeds] [samples]
+//
+// The put is priced with each seed from 1 to the given number, on the
+// constant route with antithetic variates, without and with moment
+// matching.  For each mode, the empirical standard deviation of the
+// prices across seeds is reported together with the mean of the
+// returned errorEstimate(), which should be close to it.  The program
+// exits with a non-zero status unless moment matching lowers the
+// empirical standard deviation and its error estimate is within 25%
+// of the observed one.
+
+struct Dispersion {
+    Real bias, standardDeviation, meanErrorEstimate;
+};
+
+Dispersion run(bool momentMatching, Size seeds, Size samples,
+               const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+               const boost::shared_ptr<StrikedTypePayoff>& payoff,
+               const boost::shared_ptr<Exercise>& exercise,
+               Real exact) {
+    IncrementalStatistics prices, errors;
+    for (Size seed=1; seed<=seeds; seed++) {
+        VanillaOption option(payoff, exercise);
+        option.setPricingEngine(MakeMCEuropeanEngine_2<PseudoRandom>(process)
+                                    .withSteps(10)
+                                    .withSamples(samples)
+                                    .withSeed(seed)
+                                    .withconstParameter(true)
+                                    .withAntitheticVariate()
+                                    .withMomentMatching(momentMatching));
+        prices.add(option.NPV());
+        errors.add(option.errorEstimate());
+    }
+    Dispersion s = { prices.mean() - exact, prices.standardDeviation(),
+                     errors.mean() };
+    printf("%-30s bias %+.6f  empirical std %.6f  mean errorEstimate %.6f\n",
+           momentMatching ? "antithetic + moment matching" : "antithetic",
+           s.bias, s.standardDeviation, s.meanErrorEstimate);
+    return s;
+}
+
+int main(int argc, char* argv[]) {
+
+    try {
+        Size seeds = (argc > 1 ? std::atoi(argv[1]) : 200);
+        Size samples = (argc > 2 ? std::atoi(argv[2]) : 10000);
+        QL_REQUIRE(seeds > 1, "at least two seeds required");
+        QL_REQUIRE(samples > 0, "at least one sample required");
+
+        Calendar calendar = TARGET();
+        DayCounter dayCounter = Actual365Fixed();
+        Date t0(1, March, 2019);
+        Date T(1, March, 2020);
+        Settings::instance().evaluationDate() = t0;
+        Real strike = 80;
+
+        // same market and option as main.cpp
+        Handle<YieldTermStructure> rate(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.05, dayCounter)));
+        Handle<Quote> underlying(boost::shared_ptr<Quote>(new SimpleQuote(100)));
+        Handle<BlackVolTermStructure> volatility(boost::shared_ptr<BlackVolTermStructure>(new BlackConstantVol(t0, calendar, 0.15, dayCounter)));
+        Handle<YieldTermStructure> dividend(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.03, dayCounter)));
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_BS(new GeneralizedBlackScholesProcess(underlying, dividend, rate, volatility));
+        boost::shared_ptr<Exercise> europeanExercise(new EuropeanExercise(T));
+        boost::shared_ptr<StrikedTypePayoff> payoff(new PlainVanillaPayoff(Option::Put, strike));
+
+        VanillaOption reference(payoff, europeanExercise);
+        reference.setPricingEngine(boost::shared_ptr<PricingEngine>(new AnalyticEuropeanEngine(process_BS)));
+        Real exact = reference.NPV();
+
+        printf("%lu seeds of %lu samples\n",
+               (unsigned long)seeds, (unsigned long)samples);
+        Dispersion antithetic = run(false, seeds, samples, process_BS, payoff,
+                                    europeanExercise, exact);
+        Dispersion matched = run(true, seeds, samples, process_BS, payoff,
+                                 europeanExercise, exact);
+        Real reduction =
+            antithetic.standardDeviation/matched.standardDeviation;
+        printf("standard error reduced %.2f times\n", reduction);
+
+        bool ok = true;
+        if (reduction <= 1.0) {
+            std::cerr << "moment matching does not reduce the error"
+                      << std::endl;
+            ok = false;
+        }
+        if (std::fabs(matched.meanErrorEstimate/matched.standardDeviation
+                      - 1.0) > 0.25) {
+            std::cerr << "error estimate inconsistent with the observed "
+                      << "spread" << std::endl;
+            ok = false;
+        }
+        return ok ? 0 : 1;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
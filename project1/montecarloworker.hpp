@@ -0,0 +1,455 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file montecarloworker.hpp
+    \brief Per-thread sampling unit for the Monte Carlo engines
+*/
+
+#ifndef montecarlo_worker_hpp
+#define montecarlo_worker_hpp
+
+#include "pathgenerator.hpp"
+#include <ql/methods/montecarlo/pathpricer.hpp>
+#include <ql/methods/montecarlo/sample.hpp>
+#include <ql/math/statistics/generalstatistics.hpp>
+#include <boost/utility/enable_if.hpp>
+#include <boost/type_traits/is_base_of.hpp>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Monte Carlo sampling unit
+    /*! A worker owns its path generator, path pricer and statistics
+        accumulator, so that several workers can draw samples
+        concurrently, each on its own random substream; their
+        accumulators are then combined with mergeStatistics().
+
+        Path buffers are allocated once by the generators and reused
+        for every sample, and the accumulator is given room for a
+        whole batch before it starts; therefore, the sampling loop
+        performs no heap allocation.
+
+        The interface hides the path-generator type, so that workers
+        using different generators can be driven by the same engine.
+    */
+    template <class S>
+    class MonteCarloWorker_2 {
+      public:
+        typedef S stats_type;
+        virtual ~MonteCarloWorker_2() {}
+        virtual void addSamples(Size samples) = 0;
+        const stats_type& sampleAccumulator() const {
+            return sampleAccumulator_;
+        }
+        //! accumulators of the sensitivities, if any were requested
+        const std::vector<stats_type>& sensitivityAccumulators() const {
+            return sensitivityAccumulators_;
+        }
+        #ifdef MC_ENABLE_INSTRUMENTATION
+        //! per-phase counters, including those of the path generators
+        virtual McCounters_2 counters() const { return counters_; }
+        #endif
+      protected:
+        stats_type sampleAccumulator_;
+        std::vector<stats_type> sensitivityAccumulators_;
+        #ifdef MC_ENABLE_INSTRUMENTATION
+        McCounters_2 counters_;
+        #endif
+    };
+
+
+    //! pricer of several sensitivities on the same path
+    template <class PathType>
+    class PathSensitivityPricer_2 {
+      public:
+        virtual ~PathSensitivityPricer_2() {}
+        //! number of sensitivities returned
+        virtual Size size() const = 0;
+        //! writes the size() sensitivities estimated on the path
+        virtual void operator()(const PathType& path,
+                                Real* sensitivities) const = 0;
+    };
+
+
+    //! worker pricing one path at a time
+    /*! This is the sampling loop of MonteCarloModel without the
+        control-variate machinery.  A sensitivity pricer can be given
+        to estimate sensitivities on the same paths; each of them is
+        collected in a separate accumulator.
+    */
+    template <class PG, class S>
+    class PathMonteCarloWorker_2 : public MonteCarloWorker_2<S> {
+      public:
+        typedef PG path_generator_type;
+        typedef typename PG::sample_type sample_type;
+        typedef PathPricer<typename sample_type::value_type>
+            path_pricer_type;
+        typedef PathSensitivityPricer_2<typename sample_type::value_type>
+            sensitivity_pricer_type;
+        PathMonteCarloWorker_2(
+                 const boost::shared_ptr<path_generator_type>& pathGenerator,
+                 const boost::shared_ptr<path_pricer_type>& pathPricer,
+                 bool antitheticVariate,
+                 const boost::shared_ptr<sensitivity_pricer_type>&
+                     sensitivityPricer =
+                         boost::shared_ptr<sensitivity_pricer_type>())
+        : pathGenerator_(pathGenerator), pathPricer_(pathPricer),
+          isAntitheticVariate_(antitheticVariate),
+          sensitivityPricer_(sensitivityPricer),
+          sensitivities_(sensitivityPricer ? sensitivityPricer->size() : 0),
+          antitheticSensitivities_(sensitivities_.size()) {
+            this->sensitivityAccumulators_.resize(sensitivities_.size());
+        }
+        void addSamples(Size samples);
+        #ifdef MC_ENABLE_INSTRUMENTATION
+        McCounters_2 counters() const {
+            McCounters_2 counters = this->counters_;
+            counters += pathGenerator_->counters();
+            return counters;
+        }
+        #endif
+      private:
+        boost::shared_ptr<path_generator_type> pathGenerator_;
+        boost::shared_ptr<path_pricer_type> pathPricer_;
+        bool isAntitheticVariate_;
+        boost::shared_ptr<sensitivity_pricer_type> sensitivityPricer_;
+        std::vector<Real> sensitivities_, antitheticSensitivities_;
+    };
+
+
+    //! worker pricing one path at a time against a control variate
+    /*! The control is priced on paths drawn by a second generator
+        seeded like the first, so that both see the same Gaussian
+        sequence; as in MonteCarloModel, each sample is the price
+        corrected by the difference between the known control value
+        and the control price on the path.  The uncorrected prices
+        are accumulated as well, so that the variance reduction can
+        be measured.
+    */
+    template <class PG, class CPG, class S>
+    class ControlVariateMonteCarloWorker_2 : public MonteCarloWorker_2<S> {
+      public:
+        typedef typename PG::sample_type sample_type;
+        typedef typename CPG::sample_type control_sample_type;
+        typedef PathPricer<typename sample_type::value_type>
+            path_pricer_type;
+        ControlVariateMonteCarloWorker_2(
+               const boost::shared_ptr<PG>& pathGenerator,
+               const boost::shared_ptr<path_pricer_type>& pathPricer,
+               const boost::shared_ptr<CPG>& controlPathGenerator,
+               const boost::shared_ptr<path_pricer_type>& controlPathPricer,
+               Real controlVariateValue,
+               bool antitheticVariate)
+        : pathGenerator_(pathGenerator), pathPricer_(pathPricer),
+          cvPathGenerator_(controlPathGenerator),
+          cvPathPricer_(controlPathPricer),
+          cvOptionValue_(controlVariateValue),
+          isAntitheticVariate_(antitheticVariate) {}
+        void addSamples(Size samples);
+        //! prices before the control-variate correction
+        const S& uncontrolledAccumulator() const {
+            return uncontrolledAccumulator_;
+        }
+        #ifdef MC_ENABLE_INSTRUMENTATION
+        McCounters_2 counters() const {
+            McCounters_2 counters = this->counters_;
+            counters += pathGenerator_->counters();
+            counters += cvPathGenerator_->counters();
+            return counters;
+        }
+        #endif
+      private:
+        boost::shared_ptr<PG> pathGenerator_;
+        boost::shared_ptr<path_pricer_type> pathPricer_;
+        boost::shared_ptr<CPG> cvPathGenerator_;
+        boost::shared_ptr<path_pricer_type> cvPathPricer_;
+        Real cvOptionValue_;
+        bool isAntitheticVariate_;
+        S uncontrolledAccumulator_;
+    };
+
+
+    //! worker evolving batches of constant-coefficient paths
+    /*! Paths are drawn \c batchSize at a time and stored in
+        structure-of-arrays layout, one contiguous row of spot values
+        per time step; both the evolution and the payoff are then
+        vectorized loops across the batch.  The pricer must provide
+        a batch operator() taking the terminal values.
+
+        Random numbers are consumed in the same order as by
+        PathMonteCarloWorker_2, so the two workers agree up to the
+        rounding of the vectorized exponential.
+
+        With moment matching, the Gaussian increments of each time
+        step are shifted and scaled across the batch so that their
+        sample mean and standard deviation are exactly 0 and 1; the
+        evolved paths then reproduce the drift and diffusion of the
+        process on the batch.  The paths of a batch are no longer
+        independent, so the means of the batches are collected in a
+        separate accumulator from which the error can be estimated.
+
+        A non-null \c shift is passed to the path evolver for
+        importance sampling; the pricer must then apply the
+        corresponding likelihood ratio.
+    */
+    template <class GSG, class PP, class S>
+    class BatchMonteCarloWorker_2 : public MonteCarloWorker_2<S> {
+      public:
+        BatchMonteCarloWorker_2(
+                 const boost::shared_ptr<constantBlackScholesProcess>& process,
+                 const TimeGrid& timeGrid,
+                 const GSG& generator,
+                 bool brownianBridge,
+                 const boost::shared_ptr<PP>& pathPricer,
+                 bool antitheticVariate,
+                 Size batchSize,
+                 bool momentMatching = false,
+                 Real shift = 0.0);
+        void addSamples(Size samples);
+        //! means of the batches, weighted by their size
+        const S& batchAccumulator() const { return batchAccumulator_; }
+      private:
+        void addBatch(Size n);
+        void matchMoments(Size n);
+        GSG generator_;
+        bool brownianBridge_;
+        BrownianBridge bb_;
+        PathEvolver_2<constantBlackScholesProcess> evolver_;
+        boost::shared_ptr<PP> pathPricer_;
+        bool isAntitheticVariate_;
+        Size batchSize_, steps_;
+        std::vector<Real> temp_, dw_, spots_, weights_;
+        std::vector<Real> prices_, antitheticPrices_;
+        bool momentMatching_;
+        S batchAccumulator_;
+    };
+
+
+    //! makes room for \c n samples in accumulators storing them
+    template <class S>
+    typename boost::enable_if<boost::is_base_of<GeneralStatistics,S> >::type
+    reserveSamples(S& stats, Size n) {
+        stats.reserve(n);
+    }
+
+    //! no-op for accumulators keeping running sums
+    template <class S>
+    typename boost::disable_if<boost::is_base_of<GeneralStatistics,S> >::type
+    reserveSamples(S&, Size) {}
+
+
+    //! adds the samples collected by \c from to \c to
+    /*! The generic version replays the stored samples, which works
+        for any accumulator derived from GeneralStatistics; policies
+        keeping running sums only should provide an overload.
+    */
+    template <class S>
+    void mergeStatistics(S& to, const S& from) {
+        const std::vector<std::pair<Real,Real> >& data = from.data();
+        for (Size i=0; i<data.size(); i++)
+            to.add(data[i].first, data[i].second);
+    }
+
+
+    // inline definitions
+
+    template <class PG, class S>
+    inline void PathMonteCarloWorker_2<PG,S>::addSamples(Size samples) {
+        reserveSamples(this->sampleAccumulator_,
+                       this->sampleAccumulator_.samples() + samples);
+        std::vector<S>& sensitivities = this->sensitivityAccumulators_;
+        for (Size k=0; k<sensitivities.size(); k++)
+            reserveSamples(sensitivities[k],
+                           sensitivities[k].samples() + samples);
+        for (Size j = 1; j <= samples; j++) {
+            const sample_type& path = pathGenerator_->next();
+            Real price, weight = path.weight;
+            {
+                MC_PHASE_TIMER(this->counters_, McPayoff, 1);
+                price = (*pathPricer_)(path.value);
+                if (sensitivityPricer_)
+                    (*sensitivityPricer_)(path.value, &sensitivities_[0]);
+            }
+            if (isAntitheticVariate_) {
+                // the antithetic path may overwrite the first one
+                const sample_type& atPath = pathGenerator_->antithetic();
+                MC_PHASE_TIMER(this->counters_, McPayoff, 1);
+                price = (price + (*pathPricer_)(atPath.value))/2.0;
+                if (sensitivityPricer_) {
+                    (*sensitivityPricer_)(atPath.value,
+                                          &antitheticSensitivities_[0]);
+                    for (Size k=0; k<sensitivities_.size(); k++)
+                        sensitivities_[k] = (sensitivities_[k] +
+                                             antitheticSensitivities_[k])/2.0;
+                }
+            }
+            MC_PHASE_TIMER(this->counters_, McAccumulation, 1);
+            this->sampleAccumulator_.add(price, weight);
+            for (Size k=0; k<sensitivities_.size(); k++)
+                sensitivities[k].add(sensitivities_[k], weight);
+        }
+    }
+
+
+    template <class PG, class CPG, class S>
+    inline void
+    ControlVariateMonteCarloWorker_2<PG,CPG,S>::addSamples(Size samples) {
+        reserveSamples(this->sampleAccumulator_,
+                       this->sampleAccumulator_.samples() + samples);
+        reserveSamples(uncontrolledAccumulator_,
+                       uncontrolledAccumulator_.samples() + samples);
+        for (Size j = 1; j <= samples; j++) {
+            const sample_type& path = pathGenerator_->next();
+            const control_sample_type& cvPath = cvPathGenerator_->next();
+            Real price, cvPrice;
+            {
+                MC_PHASE_TIMER(this->counters_, McPayoff, 2);
+                price = (*pathPricer_)(path.value);
+                cvPrice = (*cvPathPricer_)(cvPath.value);
+            }
+            if (isAntitheticVariate_) {
+                const sample_type& atPath = pathGenerator_->antithetic();
+                const control_sample_type& atCvPath =
+                    cvPathGenerator_->antithetic();
+                MC_PHASE_TIMER(this->counters_, McPayoff, 2);
+                price = (price + (*pathPricer_)(atPath.value))/2.0;
+                cvPrice = (cvPrice + (*cvPathPricer_)(atCvPath.value))/2.0;
+            }
+            MC_PHASE_TIMER(this->counters_, McAccumulation, 1);
+            uncontrolledAccumulator_.add(price, path.weight);
+            this->sampleAccumulator_.add(price + cvOptionValue_ - cvPrice,
+                                         path.weight);
+        }
+    }
+
+
+    template <class GSG, class PP, class S>
+    inline BatchMonteCarloWorker_2<GSG,PP,S>::BatchMonteCarloWorker_2(
+                 const boost::shared_ptr<constantBlackScholesProcess>& process,
+                 const TimeGrid& timeGrid,
+                 const GSG& generator,
+                 bool brownianBridge,
+                 const boost::shared_ptr<PP>& pathPricer,
+                 bool antitheticVariate,
+                 Size batchSize,
+                 bool momentMatching,
+                 Real shift)
+    : generator_(generator), brownianBridge_(brownianBridge), bb_(timeGrid),
+      evolver_(process, timeGrid, shift), pathPricer_(pathPricer),
+      isAntitheticVariate_(antitheticVariate), batchSize_(batchSize),
+      steps_(timeGrid.size()-1), temp_(steps_), dw_(steps_*batchSize),
+      spots_((steps_+1)*batchSize), weights_(batchSize),
+      prices_(batchSize), antitheticPrices_(batchSize),
+      momentMatching_(momentMatching) {
+        QL_REQUIRE(batchSize > 0, "null batch size");
+        QL_REQUIRE(generator_.dimension() == steps_,
+                   "sequence generator dimensionality ("
+                   << generator_.dimension() << ") != timeSteps ("
+                   << steps_ << ")");
+    }
+
+    template <class GSG, class PP, class S>
+    inline void BatchMonteCarloWorker_2<GSG,PP,S>::addSamples(Size samples) {
+        reserveSamples(this->sampleAccumulator_,
+                       this->sampleAccumulator_.samples() + samples);
+        while (samples > 0) {
+            Size n = std::min(samples, batchSize_);
+            addBatch(n);
+            samples -= n;
+        }
+    }
+
+    template <class GSG, class PP, class S>
+    inline void BatchMonteCarloWorker_2<GSG,PP,S>::addBatch(Size n) {
+        typedef typename GSG::sample_type sequence_type;
+        {
+            MC_PHASE_TIMER(this->counters_, McRng, n);
+            for (Size j=0; j<n; j++) {
+                const sequence_type& sequence = generator_.nextSequence();
+                if (brownianBridge_)
+                    bb_.transform(sequence.value.begin(), sequence.value.end(),
+                                  temp_.begin());
+                else
+                    std::copy(sequence.value.begin(), sequence.value.end(),
+                              temp_.begin());
+                for (Size i=0; i<steps_; i++)
+                    dw_[i*batchSize_+j] = temp_[i];
+                weights_[j] = sequence.weight;
+            }
+            if (momentMatching_)
+                matchMoments(n);
+        }
+
+        const Real* terminal = &spots_[steps_*batchSize_];
+        {
+            MC_PHASE_TIMER(this->counters_, McEvolution, n);
+            evolver_.evolve(spots_, dw_, n, batchSize_, false);
+        }
+        {
+            MC_PHASE_TIMER(this->counters_, McPayoff, n);
+            (*pathPricer_)(terminal, n, &prices_[0]);
+        }
+        if (isAntitheticVariate_) {
+            {
+                MC_PHASE_TIMER(this->counters_, McEvolution, n);
+                evolver_.evolve(spots_, dw_, n, batchSize_, true);
+            }
+            {
+                MC_PHASE_TIMER(this->counters_, McPayoff, n);
+                (*pathPricer_)(terminal, n, &antitheticPrices_[0]);
+            }
+            for (Size j=0; j<n; j++)
+                prices_[j] = (prices_[j]+antitheticPrices_[j])/2.0;
+        }
+
+        MC_PHASE_TIMER(this->counters_, McAccumulation, n);
+        Real sum = 0.0, weights = 0.0;
+        for (Size j=0; j<n; j++) {
+            this->sampleAccumulator_.add(prices_[j], weights_[j]);
+            sum += weights_[j]*prices_[j];
+            weights += weights_[j];
+        }
+        if (momentMatching_)
+            batchAccumulator_.add(sum/weights, weights);
+    }
+
+    template <class GSG, class PP, class S>
+    inline void BatchMonteCarloWorker_2<GSG,PP,S>::matchMoments(Size n) {
+        // a single draw has no spread to match
+        if (n < 2)
+            return;
+        for (Size i=0; i<steps_; i++) {
+            Real* dw = &dw_[i*batchSize_];
+            Real mean = 0.0, squares = 0.0;
+            for (Size j=0; j<n; j++)
+                mean += dw[j];
+            mean /= n;
+            for (Size j=0; j<n; j++)
+                squares += (dw[j]-mean)*(dw[j]-mean);
+            // population deviation: the draws of the batch get exactly
+            // unit variance, hence the paths exactly the process variance
+            Real stdDev = std::sqrt(squares/n);
+            QL_REQUIRE(stdDev > 0.0, "degenerate Gaussian draws");
+            for (Size j=0; j<n; j++)
+                dw[j] = (dw[j]-mean)/stdDev;
+        }
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,203 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file pathgenerator.hpp
+    \brief Path generator with a process-specific evolution kernel
+*/
+
+#ifndef path_generator_2_hpp
+#define path_generator_2_hpp
+
+#include "constantBlackScholesProcess.hpp"
+#include "batchkernel.hpp"
+#include "mcinstrumentation.hpp"
+#include <ql/methods/montecarlo/path.hpp>
+#include <ql/methods/montecarlo/sample.hpp>
+#include <ql/methods/montecarlo/brownianbridge.hpp>
+
+namespace QuantLib {
+
+    //! evolves a whole path of a one-dimensional process
+    /*! The generic version goes through the virtual
+        StochasticProcess1D::evolve() at each step.
+    */
+    template <class P>
+    class PathEvolver_2 {
+      public:
+        PathEvolver_2(const boost::shared_ptr<P>& process,
+                      const TimeGrid& timeGrid)
+        : process_(process), timeGrid_(timeGrid) {}
+        void evolve(Path& path,
+                    const std::vector<Real>& dw,
+                    bool antithetic) const {
+            Real sign = antithetic ? -1.0 : 1.0;
+            path.front() = process_->x0();
+            for (Size i=1; i<path.length(); i++)
+                path[i] = process_->evolve(timeGrid_[i-1], path[i-1],
+                                           timeGrid_.dt(i-1), sign*dw[i-1]);
+        }
+      private:
+        boost::shared_ptr<P> process_;
+        TimeGrid timeGrid_;
+    };
+
+
+    //! path evolution for constant coefficients
+    /*! The per-step drift and standard deviation of the log-normal
+        step are computed once for the grid, and the path is then
+        evolved in a tight, non-virtual loop.
+
+        For importance sampling, the Brownian motion can be given a
+        constant drift, chosen so that the Gaussian draw driving the
+        terminal value has mean \c shift instead of 0; the drift does
+        not change sign on antithetic paths.
+
+        Batches of paths can also be evolved in structure-of-arrays
+        layout, in which case the update of each time step is a
+        vectorized loop across paths.
+    */
+    template <>
+    class PathEvolver_2<constantBlackScholesProcess> {
+      public:
+        PathEvolver_2(
+                 const boost::shared_ptr<constantBlackScholesProcess>& process,
+                 const TimeGrid& timeGrid,
+                 Real shift = 0.0)
+        : x0_(process->x0()), drift_(timeGrid.size()-1),
+          stdDev_(timeGrid.size()-1) {
+            Volatility sigma = process->volatility();
+            Real mu = process->riskDrift() - 0.5*sigma*sigma
+                    + sigma*shift/std::sqrt(timeGrid.back());
+            for (Size i=0; i<drift_.size(); i++) {
+                drift_[i] = mu*timeGrid.dt(i);
+                stdDev_[i] = sigma*std::sqrt(timeGrid.dt(i));
+            }
+        }
+        void evolve(Path& path,
+                    const std::vector<Real>& dw,
+                    bool antithetic) const {
+            Real sign = antithetic ? -1.0 : 1.0;
+            Real x = x0_;
+            path.front() = x;
+            for (Size i=0; i<drift_.size(); i++) {
+                x *= std::exp(drift_[i] + stdDev_[i]*(sign*dw[i]));
+                path[i+1] = x;
+            }
+        }
+        /*! \param spots  one row of \c stride values per grid point;
+                          on return, the first \c n values of each
+                          row hold the evolved paths.
+            \param dw     one row of \c stride Gaussian increments
+                          per time step.
+        */
+        void evolve(std::vector<Real>& spots,
+                    const std::vector<Real>& dw,
+                    Size n,
+                    Size stride,
+                    bool antithetic) const {
+            Real sign = antithetic ? -1.0 : 1.0;
+            std::fill(spots.begin(), spots.begin()+n, x0_);
+            for (Size i=0; i<drift_.size(); i++)
+                logNormalStep(&spots[i*stride], &spots[(i+1)*stride],
+                              &dw[i*stride], n, drift_[i], sign*stdDev_[i]);
+        }
+      private:
+        Real x0_;
+        std::vector<Real> drift_, stdDev_;
+    };
+
+
+    //! Generates random paths using a sequence generator
+    /*! Same as PathGenerator, except that the process type is known
+        at compile time, so that PathEvolver_2 can select a
+        specialized evolution kernel.
+
+        \ingroup mcarlo
+    */
+    template <class GSG, class P = StochasticProcess1D>
+    class PathGenerator_2 {
+      public:
+        typedef Sample<Path> sample_type;
+        PathGenerator_2(const boost::shared_ptr<P>& process,
+                        const TimeGrid& timeGrid,
+                        const GSG& generator,
+                        bool brownianBridge)
+        : brownianBridge_(brownianBridge), generator_(generator),
+          dimension_(generator_.dimension()), timeGrid_(timeGrid),
+          evolver_(process, timeGrid), next_(Path(timeGrid_), 1.0),
+          temp_(dimension_), bb_(timeGrid_) {
+            QL_REQUIRE(dimension_==timeGrid_.size()-1,
+                       "sequence generator dimensionality (" << dimension_
+                       << ") != timeSteps (" << timeGrid_.size()-1 << ")");
+        }
+        const sample_type& next() const { return next(false); }
+        const sample_type& antithetic() const { return next(true); }
+        Size size() const { return dimension_; }
+        const TimeGrid& timeGrid() const { return timeGrid_; }
+        #ifdef MC_ENABLE_INSTRUMENTATION
+        const McCounters_2& counters() const { return counters_; }
+        #endif
+      private:
+        const sample_type& next(bool antithetic) const;
+        bool brownianBridge_;
+        GSG generator_;
+        Size dimension_;
+        TimeGrid timeGrid_;
+        PathEvolver_2<P> evolver_;
+        mutable sample_type next_;
+        mutable std::vector<Real> temp_;
+        BrownianBridge bb_;
+        #ifdef MC_ENABLE_INSTRUMENTATION
+        mutable McCounters_2 counters_;
+        #endif
+    };
+
+
+    // template definitions
+
+    template <class GSG, class P>
+    const typename PathGenerator_2<GSG,P>::sample_type&
+    PathGenerator_2<GSG,P>::next(bool antithetic) const {
+
+        {
+            MC_PHASE_TIMER(counters_, McRng, 1);
+            typedef typename GSG::sample_type sequence_type;
+            const sequence_type& sequence_ =
+                antithetic ? generator_.lastSequence()
+                           : generator_.nextSequence();
+
+            if (brownianBridge_) {
+                bb_.transform(sequence_.value.begin(),
+                              sequence_.value.end(),
+                              temp_.begin());
+            } else {
+                std::copy(sequence_.value.begin(),
+                          sequence_.value.end(),
+                          temp_.begin());
+            }
+            next_.weight = sequence_.weight;
+        }
+
+        MC_PHASE_TIMER(counters_, McEvolution, 1);
+        evolver_.evolve(next_.value, temp_, antithetic);
+        return next_;
+    }
+
+}
+
+
+#endif
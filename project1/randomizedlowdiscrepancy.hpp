@@ -0,0 +1,168 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file randomizedlowdiscrepancy.hpp
+    \brief Randomized quasi-Monte Carlo policy
+*/
+
+#ifndef randomized_low_discrepancy_hpp
+#define randomized_low_discrepancy_hpp
+
+#include "inversecumulativersg.hpp"
+#include <ql/math/randomnumbers/sobolrsg.hpp>
+#include <ql/math/randomnumbers/mt19937uniformrng.hpp>
+#include <ql/math/randomnumbers/inversecumulativenormal.hpp>
+#include <ql/methods/montecarlo/sample.hpp>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Scrambled low-discrepancy sequence generator
+    /*! Random linear scrambling with a digital shift (Matousek): in
+        each dimension, the binary digits of the 32-bit integers of
+        the underlying sequence are multiplied by a random
+        lower-triangular matrix with unit diagonal and XORed with a
+        random shift, both drawn once from the seed.  Each scramble
+        is an independent randomization of the point set which keeps
+        its equidistribution properties, so that the mean over the
+        points is an unbiased estimate; unlike a digital shift alone,
+        it also mixes the digits, which lowers the variance of that
+        mean for smooth integrands.  It is cheaper than, though not
+        as effective as, the nested scrambling of Owen.  Points are
+        taken at the center of their cell, so that they never fall
+        on 0 or 1.
+
+        See J. Matousek, "On the L2-discrepancy for anchored boxes",
+        J. of Complexity 14 (1998).
+
+        \ingroup mcarlo
+    */
+    template <class URSG>
+    class ScrambledRsg {
+      public:
+        typedef Sample<std::vector<Real> > sample_type;
+        ScrambledRsg(Size dimensionality, BigNatural seed);
+        const sample_type& nextSequence() const {
+            return scrambled(generator_.nextInt32Sequence());
+        }
+        const sample_type& lastSequence() const { return sequence_; }
+        Size dimension() const { return dimensionality_; }
+      private:
+        enum { Bytes = 4, Entries = 256 };
+        template <class IntegerSequence>
+        const sample_type& scrambled(const IntegerSequence& x) const;
+        Size dimensionality_;
+        URSG generator_;
+        // the scramble being linear, the image of an integer is the
+        // XOR of the images of its bytes; the image of byte b at
+        // position k in dimension i is at (i*Bytes+k)*Entries+b
+        std::vector<unsigned long> images_, shifts_;
+        mutable sample_type sequence_;
+    };
+
+
+    //! randomized quasi-Monte Carlo policy
+    /*! Engines supporting it draw \c Randomizations independent
+        scrambles of the sequence and estimate the error from the spread
+        of the means obtained with each of them; unlike
+        GenericLowDiscrepancy, it therefore allows an error estimate.
+    */
+    template <class URSG, class IC, Size Randomizations = 8>
+    struct GenericRandomizedLowDiscrepancy {
+        typedef ScrambledRsg<URSG> ursg_type;
+        typedef InverseCumulativeRsg_2<ursg_type,IC> rsg_type;
+        enum { allowsErrorEstimate = 1 };
+        enum { randomizations = Randomizations };
+        static rsg_type make_sequence_generator(Size dimension,
+                                                BigNatural seed) {
+            ursg_type g(dimension, seed);
+            return rsg_type(g);
+        }
+    };
+
+    //! default randomized quasi-Monte Carlo policy
+    typedef GenericRandomizedLowDiscrepancy<SobolRsg,
+                                            InverseCumulativeNormal>
+        RandomizedLowDiscrepancy;
+
+
+    //! number of independent randomizations used by a policy
+    /*! Zero for policies whose samples are independent draws. */
+    template <class RNG>
+    struct Randomizations {
+        enum { value = 0 };
+    };
+
+    template <class URSG, class IC, Size N>
+    struct Randomizations<GenericRandomizedLowDiscrepancy<URSG,IC,N> > {
+        enum { value = N };
+    };
+
+
+    // inline definitions
+
+    template <class URSG>
+    inline ScrambledRsg<URSG>::ScrambledRsg(Size dimensionality,
+                                            BigNatural seed)
+    // the fixed seed only affects the direction integers, which must
+    // be the same for every scramble
+    : dimensionality_(dimensionality), generator_(dimensionality, 1),
+      images_(dimensionality*Bytes*Entries), shifts_(dimensionality),
+      sequence_(std::vector<Real>(dimensionality), 1.0) {
+        MersenneTwisterUniformRng rng(seed);
+        for (Size i=0; i<dimensionality_; i++) {
+            // column j is the image of the j-th least significant
+            // digit: unit diagonal, random entries below it, so that
+            // the less significant digits of the result depend on the
+            // more significant ones of the input
+            unsigned long columns[Bytes*8];
+            for (Size j=0; j<Bytes*8; j++) {
+                unsigned long diagonal = 1UL << j;
+                columns[j] = diagonal | (rng.nextInt32() & (diagonal-1));
+            }
+            shifts_[i] = rng.nextInt32() & 0xffffffffUL;
+            for (Size k=0; k<Bytes; k++) {
+                unsigned long* images = &images_[(i*Bytes+k)*Entries];
+                for (Size b=0; b<Entries; b++) {
+                    images[b] = 0UL;
+                    for (Size j=0; j<8; j++)
+                        if (b & (1UL << j))
+                            images[b] ^= columns[8*k+j];
+                }
+            }
+        }
+    }
+
+    template <class URSG>
+    template <class IntegerSequence>
+    inline const typename ScrambledRsg<URSG>::sample_type&
+    ScrambledRsg<URSG>::scrambled(const IntegerSequence& x) const {
+        static const Real normalization = 1.0/4294967296.0;
+        for (Size i=0; i<dimensionality_; i++) {
+            const unsigned long* images = &images_[i*Bytes*Entries];
+            unsigned long y = shifts_[i];
+            for (Size k=0; k<Bytes; k++)
+                y ^= images[k*Entries + ((x[i] >> (8*k)) & 0xffUL)];
+            sequence_.value[i] = (y + 0.5) * normalization;
+        }
+        return sequence_;
+    }
+
+}
+
+
+#endif
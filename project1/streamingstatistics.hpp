@@ -0,0 +1,229 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file streamingstatistics.hpp
+    \brief Constant-memory statistics accumulator for long simulations
+*/
+
+#ifndef streaming_statistics_hpp
+#define streaming_statistics_hpp
+
+#include <ql/errors.hpp>
+#include <ql/types.hpp>
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <ostream>
+
+namespace QuantLib {
+
+    //! statistics tool keeping compensated running moments
+    /*! Unlike Statistics, which stores every sample, this
+        accumulator keeps the weighted mean and sum of squared
+        deviations, updated as in Welford's algorithm (in the weighted
+        form given by D. H. D. West, "Updating mean and variance
+        estimates: an improved method", Comm. ACM 22, 1979).  The
+        increments are added with Kahan compensation, so that the
+        rounding error does not grow with the number of samples;
+        10^9 samples lose no more precision than a few thousand.
+
+        Each engine worker owns one of these, and the accumulator is
+        padded to whole cache lines so that workers running on
+        different threads never write to the same line.  The partial
+        results are combined by mergeStatistics() once the threads
+        have joined, so no locking is needed.
+
+        It can be used as the \c S parameter of MCEuropeanEngine_2
+        and MakeMCEuropeanEngine_2.
+    */
+    class StreamingStatistics_2 {
+      public:
+        typedef Real value_type;
+        StreamingStatistics_2() { reset(); }
+        //! \name Inspectors
+        //@{
+        //! number of samples collected
+        Size samples() const { return samples_; }
+        //! sum of data weights
+        Real weightSum() const { return weightSum_ + weightSumError_; }
+        /*! returns the mean, defined as
+            \f[ \langle x \rangle = \frac{\sum w_i x_i}{\sum w_i}. \f]
+        */
+        Real mean() const;
+        /*! returns the variance, defined as
+            \f[ \frac{N}{N-1} \left\langle \left(
+                x-\langle x \rangle \right)^2 \right\rangle, \f]
+            as for GeneralStatistics.
+        */
+        Real variance() const;
+        Real standardDeviation() const { return std::sqrt(variance()); }
+        //! standard deviation of the mean
+        Real errorEstimate() const;
+        Real min() const;
+        Real max() const;
+        //@}
+
+        //! \name Modifiers
+        //@{
+        void add(Real value, Real weight = 1.0);
+        template <class DataIterator>
+        void addSequence(DataIterator begin, DataIterator end) {
+            for (; begin != end; ++begin)
+                add(*begin);
+        }
+        //! adds the samples collected by another accumulator
+        /*! The moments are combined as in T. F. Chan, G. H. Golub
+            and R. J. LeVeque, "Updating formulae and a pairwise
+            algorithm for computing sample variances" (1979).
+        */
+        void merge(const StreamingStatistics_2& other);
+        void reset();
+        //@}
+
+        //! \name Checkpointing
+        //@{
+        //! writes the accumulated state in native binary form
+        void save(std::ostream& out) const;
+        //! restores the state written by save()
+        void load(std::istream& in);
+        //@}
+      private:
+        // sum += term, with the rounding error carried in error
+        static void compensatedAdd(Real& sum, Real& error, Real term) {
+            Real y = term + error;
+            Real t = sum + y;
+            error = y - (t - sum);
+            sum = t;
+        }
+        char frontPadding_[64];
+        Size samples_;
+        Real weightSum_, weightSumError_;
+        Real mean_, meanError_;
+        Real squares_, squaresError_;
+        Real min_, max_;
+        char backPadding_[64];
+    };
+
+
+    //! adds the samples collected by \c from to \c to
+    inline void mergeStatistics(StreamingStatistics_2& to,
+                                const StreamingStatistics_2& from) {
+        to.merge(from);
+    }
+
+
+    // inline definitions
+
+    inline void StreamingStatistics_2::reset() {
+        samples_ = 0;
+        weightSum_ = weightSumError_ = 0.0;
+        mean_ = meanError_ = 0.0;
+        squares_ = squaresError_ = 0.0;
+        min_ = QL_MAX_REAL;
+        max_ = QL_MIN_REAL;
+    }
+
+    inline void StreamingStatistics_2::add(Real value, Real weight) {
+        QL_REQUIRE(weight >= 0.0,
+                   "negative weight (" << weight << ") not allowed");
+        if (weight == 0.0)
+            return;
+        samples_++;
+        compensatedAdd(weightSum_, weightSumError_, weight);
+        Real delta = value - mean();
+        compensatedAdd(mean_, meanError_, delta*weight/weightSum());
+        compensatedAdd(squares_, squaresError_,
+                       weight*delta*(value - mean()));
+        min_ = std::min(value, min_);
+        max_ = std::max(value, max_);
+    }
+
+    inline void
+    StreamingStatistics_2::merge(const StreamingStatistics_2& other) {
+        if (other.samples_ == 0)
+            return;
+        if (samples_ == 0) {
+            *this = other;
+            return;
+        }
+        Real weights = weightSum(), otherWeights = other.weightSum();
+        Real total = weights + otherWeights;
+        Real delta = other.mean() - mean();
+        compensatedAdd(mean_, meanError_, delta*otherWeights/total);
+        compensatedAdd(squares_, squaresError_,
+                       other.squares_ + other.squaresError_);
+        compensatedAdd(squares_, squaresError_,
+                       delta*delta*weights*otherWeights/total);
+        compensatedAdd(weightSum_, weightSumError_, other.weightSum_);
+        compensatedAdd(weightSum_, weightSumError_, other.weightSumError_);
+        samples_ += other.samples_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    inline void StreamingStatistics_2::save(std::ostream& out) const {
+        boost::uint64_t samples = samples_;
+        Real state[] = { weightSum_, weightSumError_, mean_, meanError_,
+                         squares_, squaresError_, min_, max_ };
+        out.write(reinterpret_cast<const char*>(&samples), sizeof(samples));
+        out.write(reinterpret_cast<const char*>(state), sizeof(state));
+    }
+
+    inline void StreamingStatistics_2::load(std::istream& in) {
+        boost::uint64_t samples;
+        Real state[8];
+        in.read(reinterpret_cast<char*>(&samples), sizeof(samples));
+        in.read(reinterpret_cast<char*>(state), sizeof(state));
+        QL_REQUIRE(in, "truncated statistics data");
+        samples_ = Size(samples);
+        weightSum_ = state[0]; weightSumError_ = state[1];
+        mean_ = state[2]; meanError_ = state[3];
+        squares_ = state[4]; squaresError_ = state[5];
+        min_ = state[6]; max_ = state[7];
+    }
+
+    inline Real StreamingStatistics_2::mean() const {
+        QL_REQUIRE(weightSum() > 0.0, "sampleWeight_= 0, unsufficient");
+        return mean_ + meanError_;
+    }
+
+    inline Real StreamingStatistics_2::variance() const {
+        QL_REQUIRE(weightSum() > 0.0, "sampleWeight_= 0, unsufficient");
+        QL_REQUIRE(samples_ > 1, "sample number <= 1, unsufficient");
+        Real squares = std::max<Real>(squares_ + squaresError_, 0.0);
+        return (samples_/(samples_-1.0))*squares/weightSum();
+    }
+
+    inline Real StreamingStatistics_2::errorEstimate() const {
+        return std::sqrt(variance()/samples());
+    }
+
+    inline Real StreamingStatistics_2::min() const {
+        QL_REQUIRE(samples_ > 0, "empty sample set");
+        return min_;
+    }
+
+    inline Real StreamingStatistics_2::max() const {
+        QL_REQUIRE(samples_ > 0, "empty sample set");
+        return max_;
+    }
+
+}
+
+
+#endif
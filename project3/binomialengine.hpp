@@ -27,10 +27,9 @@
 #ifndef binomial_engine_hpp
 #define binomial_engine_hpp
 
+#include "binomialrollback.hpp"
 #include <ql/methods/lattices/binomialtree.hpp>
-#include <ql/methods/lattices/bsmlattice.hpp>
 #include <ql/math/distributions/normaldistribution.hpp>
-#include <ql/pricingengines/vanilla/discretizedvanillaoption.hpp>
 #include <ql/pricingengines/greeks.hpp>
 #include <ql/processes/blackscholesprocess.hpp>
 #include <ql/termstructures/yield/flatforward.hpp>
@@ -44,6 +43,10 @@ namespace QuantLib {
         \test the correctness of the returned values is tested by
               checking it against analytic results.
 
+        When more than one thread is requested, the rollback of the
+        tree is shared among them as described for BinomialRollback_2;
+        the results do not depend on the number of threads.
+
         \todo Greeks are not overly accurate. They could be improved
               by building a tree so that it has three points at the
               current time. The value would be fetched from the middle
@@ -55,17 +58,19 @@ namespace QuantLib {
       public:
         BinomialVanillaEngine_2(
              const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
-             Size timeSteps)
-        : process_(process), timeSteps_(timeSteps) {
+             Size timeSteps,
+             Size threads = 1)
+        : process_(process), timeSteps_(timeSteps), threads_(threads) {
             QL_REQUIRE(timeSteps >= 2,
                        "at least 2 time steps required, "
                        << timeSteps << " provided");
+            QL_REQUIRE(threads > 0, "at least one thread required");
             registerWith(process_);
         }
         void calculate() const;
       private:
         boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
-        Size timeSteps_;
+        Size timeSteps_, threads_;
     };
 
 
@@ -117,12 +122,12 @@ namespace QuantLib {
         boost::shared_ptr<T> tree(new T(bs, maturity, timeSteps_,
                                         payoff->strike()));
 
-        boost::shared_ptr<BlackScholesLattice<T> > lattice(
-            new BlackScholesLattice<T>(tree, r, maturity, timeSteps_));
-
-        DiscretizedVanillaOption option(arguments_, *process_, grid);
+        BinomialRollback_2<T> rollback(
+                  tree, r, maturity, timeSteps_, *payoff,
+                  exerciseSteps(*arguments_.exercise, *process_, grid));
 
-        option.initialize(lattice, maturity);
+        Array values;
+        rollback.initialize(values);
 
         // Partial derivatives calculated from various points in the
         // binomial tree 
@@ -130,15 +135,13 @@ namespace QuantLib {
 
         // Rollback to third-last step, and get underlying prices (s2) &
         // option values (p2) at this point
-        option.rollback(grid[2]);
-        Array va2(option.values());
-        QL_ENSURE(va2.size() == 3, "Expect 3 nodes in grid at second step");
-        Real p2u = va2[2]; // up
-        Real p2m = va2[1]; // mid
-        Real p2d = va2[0]; // down (low)
-        Real s2u = lattice->underlying(2, 2); // up price
-        Real s2m = lattice->underlying(2, 1); // middle price
-        Real s2d = lattice->underlying(2, 0); // down (low) price
+        rollback.rollback(values, timeSteps_, 2, threads_);
+        Real p2u = values[2]; // up
+        Real p2m = values[1]; // mid
+        Real p2d = values[0]; // down (low)
+        Real s2u = tree->underlying(2, 2); // up price
+        Real s2m = tree->underlying(2, 1); // middle price
+        Real s2d = tree->underlying(2, 0); // down (low) price
 
         // calculate gamma by taking the first derivate of the two deltas
         Real delta2u = (p2u - p2m)/(s2u-s2m);
@@ -147,19 +150,17 @@ namespace QuantLib {
 
         // Rollback to second-last step, and get option values (p1) at
         // this point
-        option.rollback(grid[1]);
-        Array va(option.values());
-        QL_ENSURE(va.size() == 2, "Expect 2 nodes in grid at first step");
-        Real p1u = va[1];
-        Real p1d = va[0];
-        Real s1u = lattice->underlying(1, 1); // up (high) price
-        Real s1d = lattice->underlying(1, 0); // down (low) price
+        rollback.rollback(values, 2, 1);
+        Real p1u = values[1];
+        Real p1d = values[0];
+        Real s1u = tree->underlying(1, 1); // up (high) price
+        Real s1d = tree->underlying(1, 0); // down (low) price
 
         Real delta = (p1u - p1d) / (s1u - s1d);
 
         // Finally, rollback to t=0
-        option.rollback(0.0);
-        Real p0 = option.presentValue();
+        rollback.rollback(values, 1, 0);
+        Real p0 = values[0];
 
         // Store results
         results_.value = p0;
@@ -0,0 +1,345 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file binomialrollback.hpp
+    \brief In-place backward induction of vanilla options on binomial trees
+*/
+
+#ifndef binomial_rollback_hpp
+#define binomial_rollback_hpp
+
+#include <ql/exercise.hpp>
+#include <ql/instruments/payoffs.hpp>
+#include <ql/math/array.hpp>
+#include <ql/stochasticprocess.hpp>
+#include <ql/timegrid.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace QuantLib {
+
+    //! steps of a time grid at which the option can be exercised
+    /*! The exercise dates are moved to the closest grid times and the
+        conditions are those checked by DiscretizedVanillaOption.
+    */
+    inline std::vector<bool> exerciseSteps(const Exercise& exercise,
+                                           const StochasticProcess& process,
+                                           const TimeGrid& grid) {
+        std::vector<bool> steps(grid.size(), false);
+        std::vector<Size> stopping(exercise.dates().size());
+        for (Size k=0; k<stopping.size(); k++)
+            stopping[k] = grid.closestIndex(process.time(exercise.date(k)));
+        switch (exercise.type()) {
+          case Exercise::American:
+            for (Size i=stopping[0]; i<=stopping[1]; i++)
+                steps[i] = true;
+            break;
+          case Exercise::European:
+            steps[stopping[0]] = true;
+            break;
+          case Exercise::Bermudan:
+            for (Size k=0; k<stopping.size(); k++)
+                steps[stopping[k]] = true;
+            break;
+          default:
+            QL_FAIL("invalid exercise type");
+        }
+        return steps;
+    }
+
+
+    //! in-place backward induction of a vanilla option on a binomial tree
+    /*! This replaces the rollback of a DiscretizedVanillaOption on a
+        BlackScholesLattice for trees with constant branch
+        probabilities.  The option values of a level overwrite those
+        of the following one in a single buffer; each node costs one
+        multiply-add for the continuation value and, on exercise
+        steps, one call to the inlined T::underlying() and a \c max.
+        On exercise steps only the in-the-money nodes, found by
+        bisection, compare with the exercise value; elsewhere the
+        payoff is null and the continuation value is never negative.
+
+        The operations and their order are those of the lattice, so
+        the results are the same.  The loops over the nodes are
+        vectorised by the compiler when auto-vectorisation is enabled
+        (e.g., -O3 with gcc).
+
+        The levels are rolled back in blocks of up to \c levelsPerBlock
+        levels, and each block in tiles of about \c nodesPerTile nodes
+        which stay in the L1 cache while all the levels of the block
+        are computed.  Each tile is a trapezoid whose right side
+        shrinks by one node per level, so that it never needs the
+        nodes of the following tile; the values of its left node are
+        saved at each level, and once the following tile is done they
+        are used to fill the triangle left at the right edge of the
+        previous one.  Thus the values of a level cross the memory
+        bus once per block rather than once per level.
+
+        When more than one thread is requested, each thread takes a
+        contiguous range of the nodes of the first level of a block
+        and rolls back its trapezoid as above; after a barrier, each
+        thread fills the triangle left at the right edge of its range
+        from the values saved by the next thread.  This takes two
+        barriers per block instead of one per level.
+
+        In all cases, each node is still computed by the same
+        operations from the same values, so the results depend
+        neither on the tiling nor on the number of threads.
+    */
+    template <class T>
+    class BinomialRollback_2 {
+      public:
+        enum { levelsPerBlock = 128, nodesPerTile = 1024 };
+        BinomialRollback_2(const boost::shared_ptr<T>& tree,
+                           Rate riskFreeRate,
+                           Time end,
+                           Size steps,
+                           const StrikedTypePayoff& payoff,
+                           const std::vector<bool>& exerciseSteps)
+        : tree_(tree), steps_(steps),
+          discount_(std::exp(-riskFreeRate*(end/steps))),
+          pd_(tree->probability(0,0,0)), pu_(tree->probability(0,0,1)),
+          strike_(payoff.strike()), put_(payoff.optionType() == Option::Put),
+          exerciseSteps_(exerciseSteps) {
+            QL_REQUIRE(exerciseSteps_.size() == steps_+1,
+                       "exercise steps do not match the tree");
+        }
+        Size steps() const { return steps_; }
+        //! sets the option values at the last step
+        void initialize(Array& values) const;
+        //! rolls the values back from step \c from to step \c to
+        void rollback(Array& values, Size from, Size to,
+                      Size threads = 1) const;
+        //! rolls the values back from step i+1 to step i
+        void stepback(Size i, Real* values) const {
+            stepback(i, 0, i+1, values);
+        }
+        /*! rolls back the nodes \c begin to \c end (excluded) of step
+            i; values[k] holds node begin+k and is overwritten, while
+            values[end-begin] must hold node \c end of step i+1.
+        */
+        void stepback(Size i, Size begin, Size end, Real* values) const;
+      private:
+        // index of the first node of step i, between begin and end,
+        // whose underlying is not below the strike
+        Size moneynessBoundary(Size i, Size begin, Size end) const;
+        // number of levels of the next parallel block, 0 if the
+        // remaining levels should be rolled back serially
+        static Size blockLevels(Size from, Size to, Size threads);
+        /* rolls back the nodes [begin, end-k) of steps i-k for
+           0 < k <= levels, in tiles; the values of node begin at
+           steps i to i-levels+1 are saved in edge.  If end is the
+           size of step i, these are all the nodes of the steps.
+        */
+        void rollbackTrapezoid(Size i, Size levels, Size begin, Size end,
+                               Real* values, Real* edge,
+                               Real* scratch, Real* buffer) const;
+        /* rolls back the nodes [end-k, end) of steps i-k for
+           0 < k <= levels, after the trapezoid ending at end; edge
+           holds the values of node end at steps i to i-levels+1.
+        */
+        void rollbackTriangle(Size i, Size levels, Size end,
+                              const Real* edge, Real* values,
+                              Real* buffer) const;
+        Size rollbackBlocks(Real* values, Size from, Size to,
+                            Size thread, Size threads,
+                            boost::barrier* barrier,
+                            std::vector<Real>* edges) const;
+        boost::shared_ptr<T> tree_;
+        Size steps_;
+        DiscountFactor discount_;
+        Real pd_, pu_;
+        Real strike_;
+        bool put_;
+        std::vector<bool> exerciseSteps_;
+    };
+
+
+    // template definitions
+
+    template <class T>
+    void BinomialRollback_2<T>::initialize(Array& values) const {
+        values = Array(steps_+1, 0.0);
+        if (exerciseSteps_[steps_]) {
+            for (Size j=0; j<=steps_; j++) {
+                Real s = tree_->underlying(steps_, j);
+                values[j] = std::max<Real>(put_ ? strike_ - s
+                                                : s - strike_, 0.0);
+            }
+        }
+    }
+
+    template <class T>
+    void BinomialRollback_2<T>::rollback(Array& values, Size from, Size to,
+                                         Size threads) const {
+        QL_REQUIRE(from >= to && from <= steps_,
+                   "cannot roll back from step " << from
+                   << " to step " << to);
+        QL_REQUIRE(threads > 0, "at least one thread required");
+        Size i = from;
+        if (blockLevels(from, to, threads) > 0) {
+            boost::barrier barrier(static_cast<unsigned int>(threads));
+            std::vector<Real> edges(threads*levelsPerBlock);
+            boost::thread_group group;
+            for (Size t=1; t<threads; t++)
+                group.create_thread(
+                    boost::bind(&BinomialRollback_2::rollbackBlocks, this,
+                                values.begin(), from, to, t, threads,
+                                &barrier, &edges));
+            i = rollbackBlocks(values.begin(), from, to, 0, threads,
+                               &barrier, &edges);
+            group.join_all();
+        }
+        std::vector<Real> edge(levelsPerBlock), scratch(levelsPerBlock),
+                          buffer(levelsPerBlock+1);
+        while (i > to) {
+            Size levels = std::min<Size>(levelsPerBlock, i-to);
+            rollbackTrapezoid(i, levels, 0, i+1, values.begin(),
+                              &edge[0], &scratch[0], &buffer[0]);
+            i -= levels;
+        }
+    }
+
+    template <class T>
+    inline void BinomialRollback_2<T>::stepback(Size i, Size begin, Size end,
+                                                Real* values) const {
+        const T& tree = *tree_;
+        const Real pd = pd_, pu = pu_, discount = discount_;
+        const Real strike = strike_;
+        Size n = end-begin, first = n, last = n;
+        if (exerciseSteps_[i]) {
+            Size boundary = moneynessBoundary(i, begin, end) - begin;
+            first = put_ ? 0 : boundary;
+            last = put_ ? boundary : n;
+        }
+        for (Size k=0; k<first; k++)
+            values[k] = (pd*values[k] + pu*values[k+1])*discount;
+        if (put_) {
+            for (Size k=first; k<last; k++)
+                values[k] = std::max((pd*values[k] + pu*values[k+1])*discount,
+                                     strike - tree.underlying(i, begin+k));
+        } else {
+            for (Size k=first; k<last; k++)
+                values[k] = std::max((pd*values[k] + pu*values[k+1])*discount,
+                                     tree.underlying(i, begin+k) - strike);
+        }
+        for (Size k=last; k<n; k++)
+            values[k] = (pd*values[k] + pu*values[k+1])*discount;
+    }
+
+    template <class T>
+    Size BinomialRollback_2<T>::moneynessBoundary(Size i, Size begin,
+                                                  Size end) const {
+        // the underlying grows with the node index
+        Size lo = begin, hi = end;
+        while (lo < hi) {
+            Size mid = lo + (hi-lo)/2;
+            if (tree_->underlying(i, mid) < strike_)
+                lo = mid+1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    template <class T>
+    Size BinomialRollback_2<T>::blockLevels(Size from, Size to,
+                                            Size threads) {
+        if (threads == 1)
+            return 0;
+        // each range must be at least as wide as the block is deep;
+        // below 16 levels the barriers would cost more than they save
+        Size levels = std::min<Size>(levelsPerBlock, from-to);
+        levels = std::min<Size>(levels, (from+1)/threads);
+        return levels >= 16 ? levels : 0;
+    }
+
+    template <class T>
+    void BinomialRollback_2<T>::rollbackTrapezoid(Size i, Size levels,
+                                                  Size begin, Size end,
+                                                  Real* values, Real* edge,
+                                                  Real* scratch,
+                                                  Real* buffer) const {
+        // the last tile takes the remaining nodes, so that no tile is
+        // narrower than the block is deep
+        Size tiles = std::max<Size>((end-begin)/nodesPerTile, 1);
+        for (Size t=0; t<tiles; t++) {
+            Size tileBegin = begin + t*nodesPerTile;
+            Size tileEnd = (t == tiles-1 ? end : tileBegin+nodesPerTile);
+            Real* tileEdge = (t == 0 ? edge : scratch);
+            for (Size k=1; k<=levels; k++) {
+                tileEdge[k-1] = values[tileBegin];
+                stepback(i-k, tileBegin, tileEnd-k, values+tileBegin);
+            }
+            if (t > 0)
+                rollbackTriangle(i, levels, tileBegin, tileEdge,
+                                 values, buffer);
+        }
+    }
+
+    template <class T>
+    void BinomialRollback_2<T>::rollbackTriangle(Size i, Size levels,
+                                                 Size end,
+                                                 const Real* edge,
+                                                 Real* values,
+                                                 Real* buffer) const {
+        // buffer[m] holds node end-levels+m, and buffer[levels] the
+        // value of node end at the step after the one being computed
+        std::copy(values+end-levels, values+end, buffer);
+        for (Size k=1; k<=levels; k++) {
+            buffer[levels] = edge[k-1];
+            stepback(i-k, end-k, end, buffer+levels-k);
+        }
+        std::copy(buffer, buffer+levels, values+end-levels);
+    }
+
+    template <class T>
+    Size BinomialRollback_2<T>::rollbackBlocks(Real* values,
+                                               Size from, Size to,
+                                               Size thread, Size threads,
+                                               boost::barrier* barrier,
+                                               std::vector<Real>* edges)
+                                                                      const {
+        Size i = from;
+        std::vector<Real> scratch(levelsPerBlock), buffer(levelsPerBlock+1);
+        for (Size levels = blockLevels(i, to, threads); levels > 0;
+             levels = blockLevels(i, to, threads)) {
+            // nodes of step i owned by this thread
+            Size begin = thread*(i+1)/threads,
+                 end = (thread+1)*(i+1)/threads;
+            Real* edge = &(*edges)[thread*levelsPerBlock];
+            rollbackTrapezoid(i, levels, begin, end, values, edge,
+                              &scratch[0], &buffer[0]);
+            barrier->wait();
+            // the last thread has no triangle at its right edge
+            if (thread != threads-1)
+                rollbackTriangle(i, levels, end,
+                                 &(*edges)[(thread+1)*levelsPerBlock],
+                                 values, &buffer[0]);
+            barrier->wait();
+            i -= levels;
+        }
+        return i;
+    }
+
+}
+
+
+#endif
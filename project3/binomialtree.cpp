@@ -45,6 +45,8 @@ namespace QuantLib {
 
         QL_REQUIRE(pu_<=1.0, "negative probability");
         QL_REQUIRE(pu_>=0.0, "negative probability");
+
+        tabulateJumps();
     }
 
 
@@ -71,12 +73,14 @@ namespace QuantLib {
 
         QL_REQUIRE(pu_<=1.0, "negative probability");
         QL_REQUIRE(pu_>=0.0, "negative probability");
+
+        tabulateJumps();
     }
 
 
     Tian_2::Tian_2(const boost::shared_ptr<StochasticProcess1D>& process,
                    Time end, Size steps, Real)
-    : BinomialTree_2<Tian_2>(process, end, steps) {
+    : UpDownBinomialTree_2<Tian_2>(process, end, steps) {
 
         Real q = std::exp(process->variance(0.0, x0_, dt_));
         Real r = std::exp(driftPerStep_)*std::sqrt(q);
@@ -93,13 +97,16 @@ namespace QuantLib {
 
         QL_REQUIRE(pu_<=1.0, "negative probability");
         QL_REQUIRE(pu_>=0.0, "negative probability");
+
+        tabulatePowers();
     }
 
 
     LeisenReimer_2::LeisenReimer_2(
                         const boost::shared_ptr<StochasticProcess1D>& process,
                         Time end, Size steps, Real strike)
-    : BinomialTree_2<LeisenReimer_2>(process, end, (steps%2 ? steps : steps+1)) {
+    : UpDownBinomialTree_2<LeisenReimer_2>(process, end,
+                                            (steps%2 ? steps : steps+1)) {
 
         QL_REQUIRE(strike>0.0, "strike must be positive");
         Size oddSteps = (steps%2 ? steps : steps+1);
@@ -114,6 +121,7 @@ namespace QuantLib {
         up_ = ermqdt * pdash / pu_;
         down_ = (ermqdt - pu_ * up_) / (1.0 - pu_);
 
+        tabulatePowers();
     }
 
     Real Joshi4_2::computeUpProb(Real k, Real dj) const {
@@ -139,7 +147,7 @@ namespace QuantLib {
 
     Joshi4_2::Joshi4_2(const boost::shared_ptr<StochasticProcess1D>& process,
                        Time end, Size steps, Real strike)
-    : BinomialTree_2<Joshi4_2>(process, end, (steps%2 ? steps : steps+1)) {
+    : UpDownBinomialTree_2<Joshi4_2>(process, end, (steps%2 ? steps : steps+1)) {
 
         QL_REQUIRE(strike>0.0, "strike must be positive");
         Size oddSteps = (steps%2 ? steps : steps+1);
@@ -152,6 +160,8 @@ namespace QuantLib {
         Real pdash = computeUpProb((oddSteps-1.0)/2.0,d2+std::sqrt(variance));
         up_ = ermqdt * pdash / pu_;
         down_ = (ermqdt - pu_ * up_) / (1.0 - pu_);
+
+        tabulatePowers();
     }
 
 }
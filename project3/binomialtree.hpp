@@ -29,6 +29,7 @@
 #include <ql/methods/lattices/tree.hpp>
 #include <ql/instruments/dividendschedule.hpp>
 #include <ql/stochasticprocess.hpp>
+#include <vector>
 
 namespace QuantLib {
 
@@ -90,15 +91,23 @@ namespace QuantLib {
                         Size steps)
         : BinomialTree_2<T>(process, end, steps) {}
         Real underlying(Size i, Size index) const {
-            BigInteger j = 2*BigInteger(index) - BigInteger(i);
             // exploiting equal jump and the x0_ tree centering
-            return this->x0_*std::exp(j*this->dx_);
+            return this->x0_*jumps_[2*index + this->columns()-1 - i];
         }
         Real probability(Size, Size, Size branch) const {
             return (branch == 1 ? pu_ : pd_);
         }
       protected:
+        //! to be called once dx_ is set
+        /*! tabulates exp(j dx_) for -steps <= j <= steps */
+        void tabulateJumps() {
+            BigInteger n = this->columns()-1;
+            jumps_.resize(2*n+1);
+            for (BigInteger j=-n; j<=n; j++)
+                jumps_[j+n] = std::exp(j*dx_);
+        }
         Real dx_, pu_, pd_;
+        std::vector<Real> jumps_;
     };
 
 
@@ -149,61 +158,110 @@ namespace QuantLib {
     };
 
 
-    //! %Tian tree: third moment matching, multiplicative approach
-    /*! \ingroup lattices */
-    class Tian_2 : public BinomialTree_2<Tian_2> {
+    //! Base class for binomial trees with explicit up and down factors
+    /*! The powers of the up and down factors are tabulated once by
+        the derived constructor, so that underlying() costs two
+        lookups instead of two calls to std::pow.  Each entry is
+        still computed by std::pow, so the node values are exactly
+        those of the direct formula.
+
+        \ingroup lattices
+    */
+    template <class T>
+    class UpDownBinomialTree_2 : public BinomialTree_2<T> {
       public:
-        Tian_2(const boost::shared_ptr<StochasticProcess1D>&,
-               Time end,
-               Size steps,
-               Real strike);
+        UpDownBinomialTree_2(
+                        const boost::shared_ptr<StochasticProcess1D>& process,
+                        Time end,
+                        Size steps)
+        : BinomialTree_2<T>(process, end, steps) {}
         Real underlying(Size i, Size index) const {
-            return x0_ * std::pow(down_, Real(BigInteger(i)-BigInteger(index)))
-                       * std::pow(up_, Real(index));
-        };
+            return this->x0_ * downPowers_[i-index] * upPowers_[index];
+        }
         Real probability(Size, Size, Size branch) const {
             return (branch == 1 ? pu_ : pd_);
         }
       protected:
+        //! to be called once up_ and down_ are set
+        void tabulatePowers() {
+            Size n = this->columns();
+            upPowers_.resize(n);
+            downPowers_.resize(n);
+            for (Size k=0; k<n; k++) {
+                upPowers_[k] = std::pow(up_, Real(k));
+                downPowers_[k] = std::pow(down_, Real(k));
+            }
+        }
         Real up_, down_, pu_, pd_;
+        std::vector<Real> upPowers_, downPowers_;
+    };
+
+
+    //! %Tian tree: third moment matching, multiplicative approach
+    /*! \ingroup lattices */
+    class Tian_2 : public UpDownBinomialTree_2<Tian_2> {
+      public:
+        Tian_2(const boost::shared_ptr<StochasticProcess1D>&,
+               Time end,
+               Size steps,
+               Real strike);
     };
 
     //! Leisen & Reimer tree: multiplicative approach
     /*! \ingroup lattices */
-    class LeisenReimer_2 : public BinomialTree_2<LeisenReimer_2> {
+    class LeisenReimer_2 : public UpDownBinomialTree_2<LeisenReimer_2> {
       public:
         LeisenReimer_2(const boost::shared_ptr<StochasticProcess1D>&,
                        Time end,
                        Size steps,
                        Real strike);
-        Real underlying(Size i, Size index) const {
-            return x0_ * std::pow(down_, Real(BigInteger(i)-BigInteger(index)))
-                       * std::pow(up_, Real(index));
-        }
-        Real probability(Size, Size, Size branch) const {
-            return (branch == 1 ? pu_ : pd_);
-        }
-      protected:
-        Real up_, down_, pu_, pd_;
     };
 
 
-     class Joshi4_2 : public BinomialTree_2<Joshi4_2> {
+     class Joshi4_2 : public UpDownBinomialTree_2<Joshi4_2> {
       public:
         Joshi4_2(const boost::shared_ptr<StochasticProcess1D>&,
                  Time end,
                  Size steps,
                  Real strike);
-        Real underlying(Size i, Size index) const {
-            return x0_ * std::pow(down_, Real(BigInteger(i)-BigInteger(index)))
-                       * std::pow(up_, Real(index));
-        }
-        Real probability(Size, Size, Size branch) const {
-            return (branch == 1 ? pu_ : pd_);
-        }
       protected:
         Real computeUpProb(Real k, Real dj) const;
-        Real up_, down_, pu_, pd_;
+    };
+
+
+    //! whether the nodes of tree T do not depend on the strike
+    /*! Leisen-Reimer and Joshi trees center their nodes on the strike
+        passed to the constructor; the other trees ignore it, so that
+        a single tree can price options with different strikes.
+    */
+    template <class T>
+    struct StrikeIndependent {
+        enum { value = 0 };
+    };
+
+    template <>
+    struct StrikeIndependent<JarrowRudd_2> {
+        enum { value = 1 };
+    };
+
+    template <>
+    struct StrikeIndependent<CoxRossRubinstein_2> {
+        enum { value = 1 };
+    };
+
+    template <>
+    struct StrikeIndependent<AdditiveEQPBinomialTree_2> {
+        enum { value = 1 };
+    };
+
+    template <>
+    struct StrikeIndependent<Trigeorgis_2> {
+        enum { value = 1 };
+    };
+
+    template <>
+    struct StrikeIndependent<Tian_2> {
+        enum { value = 1 };
     };
 
 }
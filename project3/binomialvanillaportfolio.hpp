@@ -0,0 +1,319 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file binomialvanillaportfolio.hpp
+    \brief Binomial pricing of a portfolio of vanilla options
+*/
+
+#ifndef binomial_vanilla_portfolio_hpp
+#define binomial_vanilla_portfolio_hpp
+
+#include "binomialtree.hpp"
+#include "binomialrollback.hpp"
+#include <ql/patterns/lazyobject.hpp>
+#include <ql/pricingengines/greeks.hpp>
+#include <ql/processes/blackscholesprocess.hpp>
+#include <ql/termstructures/yield/flatforward.hpp>
+#include <ql/termstructures/volatility/equityfx/blackconstantvol.hpp>
+#include <boost/static_assert.hpp>
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace QuantLib {
+
+    //! binomial pricer for vanilla options on the same underlying
+    /*! Options are grouped by maturity; for each maturity, the flat
+        process and the tree are built once, and the options sharing
+        an exercise schedule are rolled back together.  Their values
+        are stored node by node, the options of a node being
+        contiguous (puts first, then calls), so that each level costs
+        one pass over the nodes and the loops over the options are
+        vectorised by the compiler when auto-vectorisation is enabled.
+
+        Value, delta, gamma and theta are computed for each option as
+        by BinomialVanillaEngine_2; since each option value is
+        obtained by the same operations from the same values, the
+        results are the same, unless the compiler contracts the
+        multiply-adds into fused ones differently in the two loops
+        (e.g., gcc with -march=native), in which case they can differ
+        in the last bit.  Only trees whose nodes do not depend on the
+        strike can be used.
+    */
+    template <class T>
+    class BinomialVanillaPortfolio_2 : public LazyObject {
+        BOOST_STATIC_ASSERT(StrikeIndependent<T>::value);
+      public:
+        BinomialVanillaPortfolio_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size timeSteps);
+        //! adds an option and returns its index in the portfolio
+        Size add(const boost::shared_ptr<StrikedTypePayoff>& payoff,
+                 const boost::shared_ptr<Exercise>& exercise);
+        //! \name Inspectors
+        //@{
+        Size size() const { return payoffs_.size(); }
+        //! number of distinct maturities, i.e., of trees built
+        Size maturities() const;
+        //@}
+        //! \name Results
+        //@{
+        Real NPV(Size i) const;
+        Real delta(Size i) const;
+        Real gamma(Size i) const;
+        Real theta(Size i) const;
+        //@}
+      protected:
+        void performCalculations() const;
+      private:
+        void price(const Date& maturityDate,
+                   const std::vector<Size>& options) const;
+        void rollback(const T& tree, DiscountFactor discount,
+                      const std::vector<bool>& exerciseSteps,
+                      const std::vector<Size>& options) const;
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
+        Size timeSteps_;
+        std::vector<boost::shared_ptr<StrikedTypePayoff> > payoffs_;
+        std::vector<boost::shared_ptr<Exercise> > exercises_;
+        mutable std::vector<Real> value_, delta_, gamma_, theta_;
+    };
+
+
+    // inline definitions
+
+    template <class T>
+    inline BinomialVanillaPortfolio_2<T>::BinomialVanillaPortfolio_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size timeSteps)
+    : process_(process), timeSteps_(timeSteps) {
+        QL_REQUIRE(timeSteps >= 2,
+                   "at least 2 time steps required, "
+                   << timeSteps << " provided");
+        registerWith(process_);
+    }
+
+    template <class T>
+    inline Size BinomialVanillaPortfolio_2<T>::add(
+                          const boost::shared_ptr<StrikedTypePayoff>& payoff,
+                          const boost::shared_ptr<Exercise>& exercise) {
+        QL_REQUIRE(boost::dynamic_pointer_cast<PlainVanillaPayoff>(payoff),
+                   "non-plain payoff given");
+        payoffs_.push_back(payoff);
+        exercises_.push_back(exercise);
+        update();
+        return payoffs_.size()-1;
+    }
+
+    template <class T>
+    inline Size BinomialVanillaPortfolio_2<T>::maturities() const {
+        std::set<Date> dates;
+        for (Size i=0; i<exercises_.size(); i++)
+            dates.insert(exercises_[i]->lastDate());
+        return dates.size();
+    }
+
+    template <class T>
+    inline Real BinomialVanillaPortfolio_2<T>::NPV(Size i) const {
+        QL_REQUIRE(i < payoffs_.size(),
+                   "option " << i << " not in portfolio");
+        calculate();
+        return value_[i];
+    }
+
+    template <class T>
+    inline Real BinomialVanillaPortfolio_2<T>::delta(Size i) const {
+        QL_REQUIRE(i < payoffs_.size(),
+                   "option " << i << " not in portfolio");
+        calculate();
+        return delta_[i];
+    }
+
+    template <class T>
+    inline Real BinomialVanillaPortfolio_2<T>::gamma(Size i) const {
+        QL_REQUIRE(i < payoffs_.size(),
+                   "option " << i << " not in portfolio");
+        calculate();
+        return gamma_[i];
+    }
+
+    template <class T>
+    inline Real BinomialVanillaPortfolio_2<T>::theta(Size i) const {
+        QL_REQUIRE(i < payoffs_.size(),
+                   "option " << i << " not in portfolio");
+        calculate();
+        return theta_[i];
+    }
+
+    template <class T>
+    inline void BinomialVanillaPortfolio_2<T>::performCalculations() const {
+        std::map<Date, std::vector<Size> > groups;
+        for (Size i=0; i<exercises_.size(); i++)
+            groups[exercises_[i]->lastDate()].push_back(i);
+
+        value_ = delta_ = gamma_ = theta_ = std::vector<Real>(size());
+        for (std::map<Date, std::vector<Size> >::const_iterator
+                 g = groups.begin(); g != groups.end(); ++g)
+            price(g->first, g->second);
+    }
+
+    template <class T>
+    inline void BinomialVanillaPortfolio_2<T>::price(
+                                    const Date& maturityDate,
+                                    const std::vector<Size>& options) const {
+        // same flat process and tree as BinomialVanillaEngine_2
+        DayCounter rfdc  = process_->riskFreeRate()->dayCounter();
+        DayCounter divdc = process_->dividendYield()->dayCounter();
+        DayCounter voldc = process_->blackVolatility()->dayCounter();
+        Calendar volcal = process_->blackVolatility()->calendar();
+
+        Real s0 = process_->stateVariable()->value();
+        QL_REQUIRE(s0 > 0.0, "negative or null underlying given");
+        Volatility v = process_->blackVolatility()->blackVol(maturityDate, s0);
+        Rate r = process_->riskFreeRate()->zeroRate(maturityDate,
+            rfdc, Continuous, NoFrequency);
+        Rate q = process_->dividendYield()->zeroRate(maturityDate,
+            divdc, Continuous, NoFrequency);
+        Date referenceDate = process_->riskFreeRate()->referenceDate();
+
+        Handle<YieldTermStructure> flatRiskFree(
+            boost::shared_ptr<YieldTermStructure>(
+                new FlatForward(referenceDate, r, rfdc)));
+        Handle<YieldTermStructure> flatDividends(
+            boost::shared_ptr<YieldTermStructure>(
+                new FlatForward(referenceDate, q, divdc)));
+        Handle<BlackVolTermStructure> flatVol(
+            boost::shared_ptr<BlackVolTermStructure>(
+                new BlackConstantVol(referenceDate, volcal, v, voldc)));
+
+        Time maturity = rfdc.yearFraction(referenceDate, maturityDate);
+
+        boost::shared_ptr<StochasticProcess1D> bs(
+                         new GeneralizedBlackScholesProcess(
+                                      process_->stateVariable(),
+                                      flatDividends, flatRiskFree, flatVol));
+
+        TimeGrid grid(maturity, timeSteps_);
+
+        // the strike is ignored by the trees allowed here
+        T tree(bs, maturity, timeSteps_, payoffs_[options[0]]->strike());
+        DiscountFactor discount = std::exp(-r*(maturity/timeSteps_));
+
+        std::map<std::vector<bool>, std::vector<Size> > schedules;
+        for (Size k=0; k<options.size(); k++)
+            schedules[exerciseSteps(*exercises_[options[k]], *process_,
+                                    grid)].push_back(options[k]);
+        for (std::map<std::vector<bool>, std::vector<Size> >::const_iterator
+                 s = schedules.begin(); s != schedules.end(); ++s)
+            rollback(tree, discount, s->first, s->second);
+    }
+
+    template <class T>
+    inline void BinomialVanillaPortfolio_2<T>::rollback(
+                                    const T& tree, DiscountFactor discount,
+                                    const std::vector<bool>& exerciseSteps,
+                                    const std::vector<Size>& options) const {
+        // puts by decreasing strike, then calls by increasing strike:
+        // at each node, the options in the money come first in either
+        // group and are the only ones compared with the payoff.
+        std::vector<std::pair<Real,Size> > putOrder, callOrder;
+        for (Size k=0; k<options.size(); k++) {
+            const StrikedTypePayoff& payoff = *payoffs_[options[k]];
+            if (payoff.optionType() == Option::Put)
+                putOrder.push_back(std::make_pair(-payoff.strike(),
+                                                  options[k]));
+            else
+                callOrder.push_back(std::make_pair(payoff.strike(),
+                                                   options[k]));
+        }
+        std::sort(putOrder.begin(), putOrder.end());
+        std::sort(callOrder.begin(), callOrder.end());
+        std::vector<Size> sorted;
+        for (Size k=0; k<putOrder.size(); k++)
+            sorted.push_back(putOrder[k].second);
+        for (Size k=0; k<callOrder.size(); k++)
+            sorted.push_back(callOrder[k].second);
+
+        const Size puts = putOrder.size(), m = sorted.size(), n = timeSteps_;
+        std::vector<Real> strikes(m);
+        for (Size k=0; k<m; k++)
+            strikes[k] = payoffs_[sorted[k]]->strike();
+        const Real* strike = &strikes[0];
+        const Real pd = tree.probability(0,0,0), pu = tree.probability(0,0,1);
+
+        // values[j*m+k] holds option k at node j
+        std::vector<Real> values((n+1)*m, 0.0);
+        if (exerciseSteps[n]) {
+            for (Size j=0; j<=n; j++) {
+                Real s = tree.underlying(n, j);
+                Real* v = &values[j*m];
+                for (Size k=0; k<puts; k++)
+                    v[k] = std::max<Real>(strike[k] - s, 0.0);
+                for (Size k=puts; k<m; k++)
+                    v[k] = std::max<Real>(s - strike[k], 0.0);
+            }
+        }
+
+        // option values at steps 2 and 1, for the Greeks
+        std::vector<Real> p2(3*m), p1(2*m);
+        for (Size i=n; i-- > 0; ) {
+            if (i == 1)
+                std::copy(values.begin(), values.begin()+3*m, p2.begin());
+            else if (i == 0)
+                std::copy(values.begin(), values.begin()+2*m, p1.begin());
+            // node j+1 follows node j, so that a level is rolled back
+            // in a single loop over its (i+1)*m values
+            Real* v = &values[0];
+            for (Size k=0; k<(i+1)*m; k++)
+                v[k] = (pd*v[k] + pu*v[k+m])*discount;
+            if (!exerciseSteps[i])
+                continue;
+            // the underlying grows with j, so the options in the
+            // money are fewer puts and more calls at each node
+            Size putsIn = puts, callsIn = puts;
+            for (Size j=0; j<=i; j++, v+=m) {
+                Real s = tree.underlying(i, j);
+                while (putsIn > 0 && strike[putsIn-1] <= s)
+                    --putsIn;
+                while (callsIn < m && strike[callsIn] <= s)
+                    ++callsIn;
+                for (Size k=0; k<putsIn; k++)
+                    v[k] = std::max(v[k], strike[k] - s);
+                for (Size k=puts; k<callsIn; k++)
+                    v[k] = std::max(v[k], s - strike[k]);
+            }
+        }
+
+        Real s2u = tree.underlying(2, 2), s2m = tree.underlying(2, 1),
+             s2d = tree.underlying(2, 0);
+        Real s1u = tree.underlying(1, 1), s1d = tree.underlying(1, 0);
+        for (Size k=0; k<m; k++) {
+            Size i = sorted[k];
+            // same finite differences as BinomialVanillaEngine_2
+            Real delta2u = (p2[2*m+k] - p2[m+k])/(s2u-s2m);
+            Real delta2d = (p2[m+k] - p2[k])/(s2m-s2d);
+            value_[i] = values[k];
+            delta_[i] = (p1[m+k] - p1[k]) / (s1u - s1d);
+            gamma_[i] = (delta2u - delta2d) / ((s2u-s2d)/2);
+            theta_[i] = blackScholesTheta(process_, value_[i],
+                                          delta_[i], gamma_[i]);
+        }
+    }
+
+}
+
+
+#endif
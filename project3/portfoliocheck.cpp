@@ -0,0 +1,182 @@
+#include "binomialtree.hpp"
+#include "binomialengine.hpp"
+#include "binomialvanillaportfolio.hpp"
+#include <ql/quantlib.hpp>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace QuantLib;
+
+// Checks that BinomialVanillaPortfolio_2, and BinomialVanillaEngine_2
+// with several threads, give the same results as
+// BinomialVanillaEngine_2 with one thread.
+//
+// usage: portfoliocheck [steps] [threads]
+//
+// Puts and calls struck from 60 to 160, European and American, on two
+// maturities, are priced with each tree.  The value, delta, gamma and
+// theta of each option must be equal to the last bit; the trees whose
+// nodes depend on the strike are only checked for the threaded
+// engine.  The program exits with a non-zero status if any result
+// differs.
+
+struct Results {
+    Real value, delta, gamma, theta;
+    bool operator==(const Results& other) const {
+        return value == other.value && delta == other.delta &&
+            gamma == other.gamma && theta == other.theta;
+    }
+};
+
+struct Book {
+    std::vector<boost::shared_ptr<StrikedTypePayoff> > payoffs;
+    std::vector<boost::shared_ptr<Exercise> > exercises;
+};
+
+template <class T>
+Results engineResults(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             const boost::shared_ptr<StrikedTypePayoff>& payoff,
+             const boost::shared_ptr<Exercise>& exercise,
+             Size steps, Size threads) {
+    VanillaOption option(payoff, exercise);
+    option.setPricingEngine(boost::shared_ptr<PricingEngine>(
+                   new BinomialVanillaEngine_2<T>(process, steps, threads)));
+    Results r = { option.NPV(), option.delta(), option.gamma(),
+                  option.theta() };
+    return r;
+}
+
+bool report(const std::string& tree, const std::string& route,
+            Size options, Size mismatches) {
+    printf("%-22s %-20s %4lu options: %4lu differ  %s\n",
+           tree.c_str(), route.c_str(), (unsigned long)options,
+           (unsigned long)mismatches, mismatches == 0 ? "ok" : "FAILED");
+    return mismatches == 0;
+}
+
+template <class T>
+bool checkThreads(const std::string& tree,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             const Book& book, Size steps, Size threads) {
+    Size mismatches = 0;
+    for (Size i=0; i<book.payoffs.size(); i++) {
+        Results serial = engineResults<T>(process, book.payoffs[i],
+                                          book.exercises[i], steps, 1);
+        Results threaded = engineResults<T>(process, book.payoffs[i],
+                                            book.exercises[i], steps,
+                                            threads);
+        if (!(serial == threaded))
+            ++mismatches;
+    }
+    std::ostringstream route;
+    route << "engine, " << threads << " threads";
+    return report(tree, route.str(), book.payoffs.size(), mismatches);
+}
+
+template <class T>
+bool checkPortfolio(const std::string& tree,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             const Book& book, Size steps) {
+    BinomialVanillaPortfolio_2<T> portfolio(process, steps);
+    for (Size i=0; i<book.payoffs.size(); i++)
+        portfolio.add(book.payoffs[i], book.exercises[i]);
+    Size mismatches = 0;
+    for (Size i=0; i<book.payoffs.size(); i++) {
+        Results serial = engineResults<T>(process, book.payoffs[i],
+                                          book.exercises[i], steps, 1);
+        Results shared = { portfolio.NPV(i), portfolio.delta(i),
+                           portfolio.gamma(i), portfolio.theta(i) };
+        if (!(serial == shared))
+            ++mismatches;
+    }
+    return report(tree, "portfolio", book.payoffs.size(), mismatches);
+}
+
+template <class T>
+bool checkTree(const std::string& tree,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             const Book& book, Size steps, Size threads) {
+    bool ok = checkThreads<T>(tree, process, book, steps, threads);
+    return checkPortfolio<T>(tree, process, book, steps) && ok;
+}
+
+int main(int argc, char* argv[]) {
+
+    try {
+        Size steps = (argc > 1 ? std::atoi(argv[1]) : 501);
+        Size threads = (argc > 2 ? std::atoi(argv[2]) : 4);
+        QL_REQUIRE(steps >= 2, "at least 2 time steps required");
+        QL_REQUIRE(threads > 1, "at least two threads required");
+
+        Calendar calendar = TARGET();
+        DayCounter dayCounter = Actual365Fixed();
+        Date t0(1, March, 2019);
+        Settings::instance().evaluationDate() = t0;
+
+        // same market as project1
+        Handle<YieldTermStructure> rate(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.05, dayCounter)));
+        Handle<Quote> underlying(boost::shared_ptr<Quote>(new SimpleQuote(100)));
+        Handle<BlackVolTermStructure> volatility(boost::shared_ptr<BlackVolTermStructure>(new BlackConstantVol(t0, calendar, 0.15, dayCounter)));
+        Handle<YieldTermStructure> dividend(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.03, dayCounter)));
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_BS(new GeneralizedBlackScholesProcess(underlying, dividend, rate, volatility));
+
+        Book book;
+        Date maturities[] = { Date(1, September, 2019), Date(1, March, 2020) };
+        Option::Type types[] = { Option::Put, Option::Call };
+        for (Size m=0; m<2; m++) {
+            boost::shared_ptr<Exercise> exercises[] = {
+                boost::shared_ptr<Exercise>(
+                                     new EuropeanExercise(maturities[m])),
+                boost::shared_ptr<Exercise>(
+                                 new AmericanExercise(t0, maturities[m]))
+            };
+            for (Size e=0; e<2; e++) {
+                for (Size t=0; t<2; t++) {
+                    for (Real strike=60.0; strike<=160.0; strike+=10.0) {
+                        book.payoffs.push_back(
+                            boost::shared_ptr<StrikedTypePayoff>(
+                                new PlainVanillaPayoff(types[t], strike)));
+                        book.exercises.push_back(exercises[e]);
+                    }
+                }
+            }
+        }
+
+        printf("%lu steps\n", (unsigned long)steps);
+        bool ok = true;
+        ok = checkTree<JarrowRudd_2>("JarrowRudd", process_BS, book,
+                                     steps, threads) && ok;
+        ok = checkTree<CoxRossRubinstein_2>("CoxRossRubinstein",
+                                            process_BS, book,
+                                            steps, threads) && ok;
+        ok = checkTree<AdditiveEQPBinomialTree_2>("AdditiveEQP",
+                                                  process_BS, book,
+                                                  steps, threads) && ok;
+        ok = checkTree<Trigeorgis_2>("Trigeorgis", process_BS, book,
+                                     steps, threads) && ok;
+        ok = checkTree<Tian_2>("Tian", process_BS, book,
+                               steps, threads) && ok;
+        // strike-dependent nodes: no portfolio
+        ok = checkThreads<LeisenReimer_2>("LeisenReimer", process_BS, book,
+                                          steps, threads) && ok;
+        ok = checkThreads<Joshi4_2>("Joshi4", process_BS, book,
+                                    steps, threads) && ok;
+
+        if (!ok) {
+            std::cerr << "results differ from the single-threaded engine"
+                      << std::endl;
+            return 1;
+        }
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,126 @@
+#include "binomialtree.hpp"
+#include "binomialengine.hpp"
+#include <ql/quantlib.hpp>
+#include <boost/chrono.hpp>
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace QuantLib;
+
+// Times the rollback of a put on binomial trees, level by level as
+// the engine did before tiling and in tiles as
+// BinomialRollback_2::rollback() does now, and checks that both give
+// the same values.
+//
+// usage: rollbackbenchmark [trials]
+//
+// Small trees are rolled back to the root.  For the largest ones,
+// whose levels no longer fit in the L2 cache, only the levels next to
+// maturity are rolled back, since a whole rollback would take hours.
+// The times are the best of the given number of trials; the tree is
+// built once beforehand, so that they compare the rollbacks alone.
+
+template <class T>
+double milliseconds(const BinomialRollback_2<T>& rollback, Size levels,
+                    bool tiled, Size trials, Array& values) {
+    Size steps = rollback.steps();
+    double best = QL_MAX_REAL;
+    for (Size k=0; k<trials; k++) {
+        rollback.initialize(values);
+        boost::chrono::steady_clock::time_point start =
+            boost::chrono::steady_clock::now();
+        if (tiled) {
+            rollback.rollback(values, steps, steps-levels);
+        } else {
+            for (Size i=steps; i>steps-levels; --i)
+                rollback.stepback(i-1, values.begin());
+        }
+        boost::chrono::duration<double, boost::milli> elapsed =
+            boost::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+template <class T>
+void run(const std::string& name,
+         const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+         const boost::shared_ptr<StrikedTypePayoff>& payoff,
+         const boost::shared_ptr<Exercise>& exercise,
+         Time maturity, Size steps, Size levels, Size trials) {
+    Rate r = process->riskFreeRate()->zeroRate(maturity, Continuous);
+    boost::shared_ptr<T> tree(new T(process, maturity, steps,
+                                    payoff->strike()));
+    BinomialRollback_2<T> rollback(
+                     tree, r, maturity, steps, *payoff,
+                     exerciseSteps(*exercise, *process,
+                                   TimeGrid(maturity, steps)));
+    Array byLevel, byTile;
+    double levelMs = milliseconds(rollback, levels, false, trials, byLevel);
+    double tileMs = milliseconds(rollback, levels, true, trials, byTile);
+    bool same = std::equal(byLevel.begin(),
+                           byLevel.begin() + steps-levels+1,
+                           byTile.begin());
+    // nodes of steps steps-levels to steps-1
+    double nodes = levels*(steps - 0.5*(levels-1.0));
+    printf("%-20s %-9s %8lu %8lu %11.3f %8.3f %11.3f %8.3f %8.2fx %s\n",
+           name.c_str(), exercise->type() == Exercise::American ?
+                                              "American" : "European",
+           (unsigned long)steps, (unsigned long)levels,
+           levelMs, 1.0e6*levelMs/nodes, tileMs, 1.0e6*tileMs/nodes,
+           levelMs/tileMs, same ? "same" : "DIFFERENT");
+}
+
+int main(int argc, char* argv[]) {
+
+    try {
+        Size trials = (argc > 1 ? std::atoi(argv[1]) : 3);
+        QL_REQUIRE(trials > 0, "at least one trial required");
+
+        Calendar calendar = TARGET();
+        DayCounter dayCounter = Actual365Fixed();
+        Date t0(1, March, 2019);
+        Date T(1, March, 2020);
+        Settings::instance().evaluationDate() = t0;
+        Real strike = 100;
+
+        Handle<YieldTermStructure> rate(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.05, dayCounter)));
+        Handle<Quote> underlying(boost::shared_ptr<Quote>(new SimpleQuote(100)));
+        Handle<BlackVolTermStructure> volatility(boost::shared_ptr<BlackVolTermStructure>(new BlackConstantVol(t0, calendar, 0.15, dayCounter)));
+        Handle<YieldTermStructure> dividend(boost::shared_ptr<YieldTermStructure>(new FlatForward(t0, 0.03, dayCounter)));
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_BS(new GeneralizedBlackScholesProcess(underlying, dividend, rate, volatility));
+        boost::shared_ptr<Exercise> europeanExercise(new EuropeanExercise(T));
+        boost::shared_ptr<Exercise> americanExercise(new AmericanExercise(t0, T));
+        boost::shared_ptr<StrikedTypePayoff> payoff(new PlainVanillaPayoff(Option::Put, strike));
+        Time maturity = dayCounter.yearFraction(t0, T);
+
+        printf("%-20s %-9s %8s %8s %11s %8s %11s %8s %9s\n",
+               "tree", "exercise", "steps", "levels",
+               "levels (ms)", "ns/node", "tiles (ms)", "ns/node",
+               "speedup");
+        Size steps[] = { 2000, 10000, 50000, 250000, 1000000 };
+        Size levels[] = { 2000, 10000, 50000, 1024, 1024 };
+        boost::shared_ptr<Exercise> exercises[] = { europeanExercise,
+                                                    americanExercise };
+        for (Size i=0; i<sizeof(steps)/sizeof(steps[0]); i++) {
+            for (Size j=0; j<2; j++) {
+                run<CoxRossRubinstein_2>("Cox-Ross-Rubinstein", process_BS,
+                                         payoff, exercises[j], maturity,
+                                         steps[i], levels[i], trials);
+                run<LeisenReimer_2>("Leisen-Reimer", process_BS,
+                                    payoff, exercises[j], maturity,
+                                    steps[i], levels[i], trials);
+            }
+        }
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}